@@ -1,30 +1,47 @@
-#pragma once
-
-#include <string>
-#include <memory>
-
-class Blob {
-private:
-    std::string hash;
-    std::string content;
-    std::string filename;
-
-public:
-    Blob(const std::string& content, const std::string& filename = "");
-    
-    // Getters
-    std::string get_hash() const { return hash; }
-    std::string get_content() const { return content; }
-    std::string get_filename() const { return filename; }
-    
-    // Setters
-    void set_hash(const std::string& h) { hash = h; }
-    void set_content(const std::string& c) { content = c; }
-    void set_filename(const std::string& f) { filename = f; }
-    
-    // Utility methods
-    std::string to_string() const;
-    static std::shared_ptr<Blob> from_string(const std::string& data);
-    bool is_empty() const { return content.empty(); }
-    size_t size() const { return content.size(); }
-}; 
+#pragma once
+
+#include "utils.h"
+#include <string>
+#include <memory>
+
+class Blob {
+private:
+    std::string hash;
+    std::string content;
+    std::string filename; // working-tree name; not part of the stored object
+    bool large;           // content lives in the large-object store
+    size_t content_size;
+
+public:
+    // Content already hashed, e.g. together with others by sha1_multi
+    Blob(std::string content, const std::string& filename, const std::string& hash);
+    // Blob named by the hash of `Policy` (object_id.h) over its content
+    template <class Policy>
+    static std::shared_ptr<Blob> create(std::string content, const std::string& filename = "") {
+        std::string hash = utils::hash_object(Policy::algorithm(), "blob", content);
+        return std::make_shared<Blob>(std::move(content), filename, hash);
+    }
+    
+    // Blob whose content is kept out of line; only hash and size are held.
+    static std::shared_ptr<Blob> large_file(const std::string& hash, size_t size,
+                                            const std::string& filename = "");
+    
+    // Getters
+    std::string get_hash() const { return hash; }
+    std::string get_content() const { return content; }
+    std::string get_filename() const { return filename; }
+    
+    // Setters
+    void set_hash(const std::string& h) { hash = h; }
+    void set_content(const std::string& c) { content = c; content_size = c.size(); large = false; }
+    void set_filename(const std::string& f) { filename = f; }
+    
+    // Utility methods
+    std::string to_string() const;
+    // Blob with id `hash` from its stored form; nullptr if that is malformed
+    // or its length does not match the content
+    static std::shared_ptr<Blob> from_string(const std::string& data, const std::string& hash);
+    bool is_empty() const { return content_size == 0; }
+    bool is_large() const { return large; }
+    size_t size() const { return content_size; }
+}; 
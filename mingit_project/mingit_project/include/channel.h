@@ -0,0 +1,138 @@
+#pragma once
+
+#include "executor.h"
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Bounded multi-producer, multi-consumer queue between coroutine stages.
+// push() suspends while the queue is full and pop() suspends while it is
+// empty, so a slow stage applies backpressure without blocking a pool
+// thread. Suspended coroutines are resumed through the executor.
+template <typename T>
+class Channel {
+private:
+    struct Pusher {
+        std::coroutine_handle<> handle;
+        T* value;
+    };
+    struct Popper {
+        std::coroutine_handle<> handle;
+        T* out;
+        bool* ok;
+    };
+
+    Executor& executor;
+    size_t capacity;
+    std::mutex mutex;
+    std::deque<T> buffer;
+    std::deque<Pusher> pushers;
+    std::deque<Popper> poppers;
+    bool closed = false;
+
+    void resume_later(const std::vector<std::coroutine_handle<>>& handles) {
+        for (auto handle : handles) {
+            executor.post([handle] { handle.resume(); });
+        }
+    }
+
+public:
+    Channel(Executor& executor, size_t capacity)
+        : executor(executor), capacity(capacity > 0 ? capacity : 1) {}
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    // Moves `value` into the channel. The awaiters only hold pointers to
+    // the caller's named variables rather than the values themselves, which
+    // keeps them trivially copyable inside coroutine frames.
+    auto push(T& value) {
+        struct Awaiter {
+            Channel* channel;
+            T* value;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::vector<std::coroutine_handle<>> wake;
+                {
+                    std::lock_guard<std::mutex> lock(channel->mutex);
+                    if (!channel->poppers.empty()) {
+                        // Hand the value straight to a waiting consumer
+                        Popper popper = channel->poppers.front();
+                        channel->poppers.pop_front();
+                        *popper.out = std::move(*value);
+                        *popper.ok = true;
+                        wake.push_back(popper.handle);
+                    } else if (channel->buffer.size() < channel->capacity) {
+                        channel->buffer.push_back(std::move(*value));
+                    } else {
+                        channel->pushers.push_back({handle, value});
+                        return true;
+                    }
+                }
+                channel->resume_later(wake);
+                return false;
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this, &value};
+    }
+
+    // Moves the next value into `out`. Yields false once the channel is
+    // closed and drained.
+    auto pop(T& out) {
+        struct Awaiter {
+            Channel* channel;
+            T* out;
+            bool ok;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::vector<std::coroutine_handle<>> wake;
+                {
+                    std::lock_guard<std::mutex> lock(channel->mutex);
+                    if (!channel->buffer.empty()) {
+                        *out = std::move(channel->buffer.front());
+                        channel->buffer.pop_front();
+                        ok = true;
+                        // A slot opened up; let one blocked producer in
+                        if (!channel->pushers.empty()) {
+                            Pusher pusher = channel->pushers.front();
+                            channel->pushers.pop_front();
+                            channel->buffer.push_back(std::move(*pusher.value));
+                            wake.push_back(pusher.handle);
+                        }
+                    } else if (!channel->closed) {
+                        channel->poppers.push_back({handle, out, &ok});
+                        return true;
+                    } else {
+                        ok = false;
+                    }
+                }
+                channel->resume_later(wake);
+                return false;
+            }
+
+            bool await_resume() const noexcept { return ok; }
+        };
+        return Awaiter{this, &out, false};
+    }
+
+    // No more values will be pushed; waiting consumers get false
+    void close() {
+        std::vector<std::coroutine_handle<>> wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            for (const auto& popper : poppers) {
+                wake.push_back(popper.handle);
+            }
+            poppers.clear();
+        }
+        resume_later(wake);
+    }
+};
@@ -5,6 +5,8 @@
 #include <map>
 #include <memory>
 #include <ctime>
+#include <ostream>
+#include <openssl/evp.h>
 
 class Commit {
 private:
@@ -15,6 +17,9 @@ private:
     std::vector<std::string> parent_hashes;
     std::map<std::string, std::string> file_blobs; // filename -> blob_hash
 
+    void write_body(std::ostream& out) const;
+    std::string compute_hash(const EVP_MD* algorithm) const;
+
 public:
     Commit(const std::string& msg, const std::string& auth = "user");
     
@@ -28,11 +33,15 @@ public:
     
     // Setters
     void set_hash(const std::string& h) { hash = h; }
+    void set_timestamp(std::time_t t) { timestamp = t; }
     void add_parent(const std::string& parent_hash);
     void add_file(const std::string& filename, const std::string& blob_hash);
     void remove_file(const std::string& filename);
     
     // Utility methods
+    // Id under the hash of `Policy` (object_id.h)
+    template <class Policy>
+    std::string compute_hash() const { return compute_hash(Policy::algorithm()); }
     std::string to_string() const;
     static std::shared_ptr<Commit> from_string(const std::string& data);
     bool has_parent(const std::string& parent_hash) const;
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "pack.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+
+// A commit to record in a commit-graph
+struct CommitGraphEntry {
+    std::string hash;
+    std::vector<std::string> parents;
+    std::time_t timestamp = 0;
+};
+
+// One commit-graph file: commit ancestry in a compact, mapped form, so
+// history walks need not load and parse commit objects.
+//
+//   "MGCG" | version (be32) | base commits (be32, version 2) | fan-out:
+//   256 x be32 | ids: n x ID_SIZE bytes, sorted | per commit: first
+//   parent, second parent, generation (be32 each), timestamp (be64) | extra
+//   edges: be32 each | `Policy` hash of the above
+//
+// A file can be a layer on top of others (see CommitGraphChain); its
+// commits then take positions [base, base + n) and parents are positions
+// across the whole chain. A missing parent is NO_PARENT; for commits with
+// more than two parents the second field is EXTRA_EDGES | i, pointing at a
+// list in the edge table whose last entry has the top bit set. Generation
+// is 1 for a root commit and 1 + the largest parent generation otherwise.
+// open() rejects a file whose checksum does not match or whose parents
+// are not below it in the chain by position or, within the file, by
+// generation.
+template <class Policy>
+class BasicCommitGraph {
+public:
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    utils::MappedFile file;
+    const unsigned char* fanout = nullptr;
+    const unsigned char* ids = nullptr;
+    const unsigned char* records = nullptr;
+    const unsigned char* edges = nullptr;
+    std::uint32_t base = 0;
+    std::uint32_t count = 0;
+    std::uint32_t edge_count = 0;
+
+public:
+    static constexpr std::uint32_t NO_PARENT = 0x70000000;
+    static constexpr std::uint32_t EXTRA_EDGES = 0x80000000;
+
+    using Entry = CommitGraphEntry;
+
+    // Resolves a parent outside the file being built to its chain position
+    // and generation
+    using BaseLookup = std::function<bool(const std::string& hash, std::uint32_t& position,
+                                          std::uint32_t& generation)>;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // Positions are chain-wide: [base_count(), base_count() + size()).
+    // Lookups outside that range give an empty or zero result.
+    std::uint32_t base_count() const { return base; }
+    std::uint32_t size() const { return count; }
+
+    bool find(const std::string& hash, std::uint32_t& position) const;
+    std::string hash_at(std::uint32_t position) const;
+    std::vector<std::uint32_t> parents(std::uint32_t position) const;
+    std::uint32_t generation(std::uint32_t position) const;
+    std::time_t timestamp(std::uint32_t position) const;
+
+    // Serializes `commits` as a layer above `base_count` commits. Parents
+    // that are neither in `commits` nor found by `lookup` are dropped.
+    static std::string build(const std::vector<Entry>& commits, std::uint32_t base_count,
+                             const BaseLookup& lookup);
+};
+
+// The commit-graph as a chain of layers in objects/info/commit-graphs:
+// graph-<checksum>.graph files listed bottom to top in commit-graph-chain.
+// New commits go into a small layer on top, so keeping the graph current
+// costs O(new commits); a layer is merged into the one below whenever it
+// grows past 1/ratio of that layer's size, which keeps the chain
+// logarithmic in length. A single objects/info/commit-graph file written
+// by older versions is read as a one-layer chain.
+template <class Policy>
+class BasicCommitGraphChain {
+public:
+    using CommitGraph = BasicCommitGraph<Policy>;
+
+private:
+    std::string info_dir;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<CommitGraph>> layers;
+
+    const CommitGraph* layer_of(std::uint32_t position) const;
+    bool find_below(const std::string& hash, size_t layer_limit, std::uint32_t& position) const;
+    std::vector<CommitGraphEntry> layer_entries(size_t layer) const;
+
+public:
+    explicit BasicCommitGraphChain(const std::string& info_dir);
+
+    void load();
+    size_t layer_count() const { return layers.size(); }
+    std::uint32_t size() const;
+
+    bool find(const std::string& hash, std::uint32_t& position) const;
+    std::string hash_at(std::uint32_t position) const;
+    std::vector<std::uint32_t> parents(std::uint32_t position) const;
+    std::uint32_t generation(std::uint32_t position) const;
+    std::time_t timestamp(std::uint32_t position) const;
+
+    // Adds `commits`, whose parents are in the chain or in `commits`, as a
+    // new top layer and merges layers by `size_ratio`, then reloads
+    bool append(const std::vector<CommitGraphEntry>& commits, unsigned size_ratio);
+};
+
+extern template class BasicCommitGraph<Sha1Policy>;
+extern template class BasicCommitGraph<Sha256Policy>;
+extern template class BasicCommitGraphChain<Sha1Policy>;
+extern template class BasicCommitGraphChain<Sha256Policy>;
+
+using CommitGraph = BasicCommitGraph<Sha1Policy>;
+using CommitGraphChain = BasicCommitGraphChain<Sha1Policy>;
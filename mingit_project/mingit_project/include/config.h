@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstdint>
+
+// Repository settings stored in .minigit/config as "section.key = value"
+// lines. Lines starting with '#' are comments.
+class Config {
+private:
+    std::string path;
+    std::map<std::string, std::string> values;
+
+public:
+    Config(const std::string& path = "");
+    
+    bool load();
+    bool save() const;
+    
+    // Getters
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+    std::string get(const std::string& key, const std::string& default_value = "") const;
+    std::int64_t get_int(const std::string& key, std::int64_t default_value) const;
+    bool get_bool(const std::string& key, bool default_value) const;
+    const std::map<std::string, std::string>& get_all() const { return values; }
+    
+    // Setters
+    void set(const std::string& key, const std::string& value) { values[key] = value; }
+    void unset(const std::string& key) { values.erase(key); }
+};
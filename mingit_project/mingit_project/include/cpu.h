@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+namespace sha1_multi {
+    struct Lane;
+}
+
+// CPU feature detection and the table of kernels bound from it. Features
+// are read once, on first use (main does so at startup), and every SIMD
+// kernel is reached through the table, so one binary runs the best code
+// each machine supports. Each entry has a portable fallback. Setting
+// MINIGIT_FORCE_SCALAR to anything but 0 binds the fallbacks everywhere,
+// to exercise them or to compare results.
+namespace cpu {
+    struct Features {
+        bool avx2 = false;
+        bool avx512f = false;
+        bool sha = false; // SHA-1/SHA-256 instructions
+    };
+
+    struct Kernels {
+        // Hashes up to `sha1_lanes` messages at once; null to hash inputs
+        // one at a time with OpenSSL
+        void (*sha1_compress)(sha1_multi::Lane* lanes) = nullptr;
+        size_t sha1_lanes = 1;
+        // See hex.h
+        void (*hex_encode)(const unsigned char* data, size_t length, char* out) = nullptr;
+        bool (*hex_decode)(const char* hex, size_t length, unsigned char* out) = nullptr;
+    };
+
+    // As detected, or all false under MINIGIT_FORCE_SCALAR
+    const Features& features();
+    const Kernels& kernels();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary deltas between objects, as stored in pack ofs-delta entries:
+//
+//   base size (varint) | result size (varint) | instructions
+//
+// An instruction byte with the top bit set copies from the base: bits 0-3
+// say which little-endian offset bytes follow, bits 4-6 which size bytes
+// (a size of 0 means 0x10000). A byte 1-127 inserts that many literal
+// bytes that follow it. 0 is reserved.
+namespace delta {
+    // Rebuilds the target; false if the delta is malformed or does not
+    // match `base`
+    bool apply(const std::string& base, const std::string& delta, std::string& out);
+
+    // Rebuilds only the first `length` bytes of the target (fewer if it is
+    // shorter). `delta` may be cut off after the instructions producing
+    // them, which take at most 8 * length + 20 bytes, and `base` may be a
+    // prefix of the base. If that prefix is too short, returns false with
+    // `base_needed` set to the length required; otherwise it is 0.
+    bool apply_prefix(const std::string& base, const std::string& delta, size_t length,
+                      std::string& out, size_t& base_needed);
+
+    // Hash table over the 16-byte blocks of a base object, built once and
+    // reused for every target compared against that base. The base must
+    // outlive the index.
+    class Index {
+    private:
+        const std::string& base;
+        std::uint32_t mask = 0;
+        std::vector<std::uint32_t> heads; // bucket -> first block + 1, 0 if empty
+        std::vector<std::uint32_t> next;  // block -> next block in bucket + 1
+
+    public:
+        static constexpr size_t BLOCK = 16;
+
+        explicit Index(const std::string& base);
+        size_t memory() const;
+
+        // Delta from the base to `target`, or "" if it would be larger
+        // than `max_size`
+        std::string create(const std::string& target, size_t max_size) const;
+    };
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// zlib preset dictionaries for packs of many small objects. On its own a
+// small object compresses poorly: its first occurrence of every word has
+// nothing earlier to refer to. A dictionary of byte strings common across
+// the repository gives it that history.
+namespace dictionary {
+    // zlib only looks back this far, so a longer dictionary is wasted
+    constexpr size_t MAX_SIZE = 32 << 10;
+
+    // Picks segments of `samples` whose 8-byte substrings occur in the
+    // most samples, greedily and without counting a substring twice, until
+    // `max_size` bytes. The most useful segments go last, nearest to the
+    // data. Deterministic for the same samples.
+    std::string train(const std::vector<std::string>& samples, size_t max_size);
+}
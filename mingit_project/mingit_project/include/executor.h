@@ -0,0 +1,70 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <thread>
+#include <stop_token>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own jobs at the back and, when empty, steals from the front of the
+// others. Jobs posted from outside the pool are spread round-robin.
+// Coroutines move onto a worker with `co_await executor.schedule()`.
+class Executor {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{0};
+    std::atomic<unsigned> next_queue{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    bool pop_local(unsigned index, std::function<void()>& job);
+    bool steal(unsigned thief, std::function<void()>& job);
+    void worker_loop(unsigned index);
+
+public:
+    explicit Executor(unsigned thread_count);
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void post(std::function<void()> job);
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    // Runs fn(i) for i in [0, count) on the pool. The calling thread works
+    // through items as well, so this is safe to call from a pool worker.
+    // Returns false if stop was requested before every item started.
+    bool parallel_for(size_t count, const std::function<void(size_t)>& fn,
+                      std::stop_token stop = {});
+
+    auto schedule() {
+        struct Awaiter {
+            Executor& executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                executor.post([handle] { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // Process-wide pool shared by every parallel subsystem. Its size comes
+    // from configure_shared (core.threads) if that is called before first
+    // use; 0 means one thread per hardware thread.
+    static void configure_shared(unsigned thread_count);
+    static Executor& shared();
+};
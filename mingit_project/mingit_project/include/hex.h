@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+// Hex conversion of object ids, which every printed, parsed or file-named
+// id goes through. utils::hex_encode and utils::hex_decode call whichever
+// of these cpu::kernels() bound. The vector versions do 16 bytes at a time
+// and hand the rest to the table-driven ones.
+namespace hex {
+    // Writes 2 * `length` lowercase digits to `out`
+    void encode_scalar(const unsigned char* data, size_t length, char* out);
+    void encode_avx2(const unsigned char* data, size_t length, char* out);
+
+    // Reads 2 * `length` digits of either case; false, with `out` partly
+    // written, if any is not a hex digit
+    bool decode_scalar(const char* hex, size_t length, unsigned char* out);
+    bool decode_avx2(const char* hex, size_t length, unsigned char* out);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// One whole-file read or write. Reads fill `data`; writes consume it.
+struct IoRequest {
+    std::string path;
+    std::string data;
+    bool ok = false;
+};
+
+// Batched file I/O. Implementations keep up to the configured queue depth of
+// requests in flight instead of handling one file at a time.
+class IoEngine {
+public:
+    virtual ~IoEngine() = default;
+
+    virtual void read_files(std::vector<IoRequest>& requests) = 0;
+    virtual void write_files(std::vector<IoRequest>& requests) = 0;
+    virtual std::string name() const = 0;
+
+    // kind is "io_uring", "threads" or "auto" (io_uring when the kernel
+    // allows it, threads otherwise).
+    static std::unique_ptr<IoEngine> create(const std::string& kind, unsigned queue_depth);
+};
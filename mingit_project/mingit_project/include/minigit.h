@@ -1,44 +1,179 @@
-#pragma once
-
-#include <string>
-#include <vector>
-#include <map>
-#include <fstream>
-#include <sstream>
-#include <iostream>
-#include <filesystem>
-#include <openssl/sha.h>
-#include <iomanip>
-
-namespace utils {
-    // File operations
-    std::string read_file(const std::string& filename);
-    bool write_file(const std::string& filename, const std::string& content);
-    bool file_exists(const std::string& filename);
-    bool directory_exists(const std::string& path);
-    void create_directory(const std::string& path);
-    std::vector<std::string> list_files(const std::string& directory);
-    
-    // Hashing
-    std::string sha1_hash(const std::string& input);
-    std::string hex_encode(const unsigned char* data, size_t length);
-    
-    // String operations
-    std::vector<std::string> split(const std::string& str, char delimiter);
-    std::string trim(const std::string& str);
-    std::string join(const std::vector<std::string>& vec, const std::string& delimiter);
-    
-    // Time operations
-    std::string timestamp_to_string(std::time_t timestamp);
-    std::time_t string_to_timestamp(const std::string& str);
-    
-    // Diff operations
-    std::vector<std::string> compute_diff(const std::string& old_content, const std::string& new_content);
-    std::string apply_patch(const std::string& content, const std::vector<std::string>& patch);
-    
-    // Color output (for terminal)
-    void print_success(const std::string& message);
-    void print_error(const std::string& message);
-    void print_warning(const std::string& message);
-    void print_info(const std::string& message);
-} 
+#pragma once
+
+#include "blob.h"
+#include "commit.h"
+#include "branch.h"
+#include "config.h"
+#include "io_engine.h"
+#include "pack_store.h"
+#include "commit_graph.h"
+#include "object_id.h"
+#include "pack_builder.h"
+#include "utils.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <iosfwd>
+#include <stop_token>
+#include <mutex>
+
+// Receives each object requested from load_objects with its serialized form
+// (empty if the object is missing).
+using ObjectCallback = std::function<void(const std::string& hash, const std::string& data)>;
+
+template <class Policy>
+class BasicFastImporter;
+
+// A repository whose objects are named by the hash of `Policy`
+// (object_id.h). Its object format is fixed when it is created; main()
+// reads it once and instantiates the matching class, so the object store,
+// pack store and commit-graph beneath never branch on it.
+template <class Policy>
+class BasicMiniGit {
+private:
+    friend class BasicFastImporter<Policy>;
+
+    using PackIndex = BasicPackIndex<Policy>;
+    using Pack = BasicPack<Policy>;
+    using PackLocation = BasicPackLocation<Policy>;
+    using PackStore = BasicPackStore<Policy>;
+    using PackBuilder = BasicPackBuilder<Policy>;
+    using CommitGraph = BasicCommitGraph<Policy>;
+    using CommitGraphChain = BasicCommitGraphChain<Policy>;
+
+    std::string repo_path;
+    std::string minigit_path;
+    std::string objects_path;
+    std::string refs_path;
+    std::string head_path;
+    std::string large_path;
+    std::string pack_path;
+    std::string current_branch;
+    bool is_initialized;
+    Config config;
+    mutable std::unique_ptr<IoEngine> io;
+    mutable std::unique_ptr<PackStore> pack_store;
+    mutable std::once_flag pack_store_loaded;
+    mutable std::unique_ptr<CommitGraphChain> graph;
+    std::stop_source cancellation;
+
+    std::map<std::string, std::shared_ptr<Branch>> branches;
+    std::map<std::string, std::shared_ptr<Blob>> staging_area; // filename -> blob
+
+    // Repository setup
+    void create_directory_structure();
+    unsigned thread_count() const;
+    IoEngine& io_engine() const;
+    unsigned io_queue_depth() const;
+    PackStore& packs() const;
+    const CommitGraphChain& commit_graph() const;
+
+    // Object naming: full hex ids of this format, and the ids of many
+    // objects at once (several per call through sha1_multi for SHA-1)
+    static bool is_object_id(const std::string& hash);
+    static std::vector<std::string> hash_all(const std::vector<std::string_view>& inputs);
+    static std::vector<std::string> hash_objects(const std::string& type,
+                                                 const std::vector<std::string_view>& payloads);
+
+    // Object storage
+    bool has_object(const std::string& hash) const;
+    int compression_level() const;
+    std::string encode_object(const std::string& data) const;
+    static std::string decode_object(const std::string& data);
+    std::string read_object(const std::string& hash) const;
+    bool object_info(const std::string& hash, ObjectInfo& info) const;
+    bool write_objects(const std::vector<std::shared_ptr<Blob>>& blobs);
+    void load_objects(const std::vector<std::string>& hashes, const ObjectCallback& callback) const;
+    bool save_blob(const std::shared_ptr<Blob>& blob);
+    std::string store_large_file(const std::string& filename, std::uintmax_t size);
+    std::shared_ptr<Blob> load_blob(const std::string& hash);
+    std::uintmax_t large_file_threshold() const;
+    bool save_commit(const std::shared_ptr<Commit>& commit);
+    std::shared_ptr<Commit> load_commit(const std::string& hash);
+    std::vector<std::string> list_loose_objects() const;
+
+    // References
+    void save_head(const std::string& commit_hash);
+    std::string load_head() const;
+    void save_branch(const std::shared_ptr<Branch>& branch);
+    std::shared_ptr<Branch> load_branch(const std::string& name);
+
+    // History and merge helpers
+    std::vector<std::string> get_commit_ancestors(const std::string& commit_hash);
+    std::string find_lowest_common_ancestor(const std::string& commit1_hash, const std::string& commit2_hash);
+    std::map<std::string, std::string> get_file_changes(const std::string& from_hash, const std::string& to_hash);
+    std::string merge_files(const std::string& base_content, const std::string& ours_content, const std::string& theirs_content);
+
+    // Maintenance (maintenance.cpp)
+    std::vector<std::string> reference_tips() const;
+    std::vector<typename CommitGraph::Entry> commits_outside_graph(size_t limit);
+    bool update_commit_graph();
+    bool run_maintenance(const std::string& only_task, bool auto_only);
+    void maybe_run_maintenance();
+
+public:
+    BasicMiniGit(const std::string& path = ".");
+
+    // Commands. A new repository records Policy::NAME as its object format.
+    bool init();
+    bool add(const std::string& filename);
+    bool add(const std::vector<std::string>& filenames);
+    bool commit(const std::string& message);
+    bool log();
+    bool branch(const std::string& branch_name);
+    bool checkout(const std::string& target);
+    bool merge(const std::string& branch_name);
+    bool diff(const std::string& commit1, const std::string& commit2);
+    bool config_value(const std::string& key, const std::string& value = "");
+    bool repack(unsigned geometric_factor = 0);
+    // -t: type, -s: size, -p: content
+    bool cat_file(const std::string& option, const std::string& hash);
+    // Long-lived mode: reads one id per line and writes "<id> <type>
+    // <size>", followed by the content and a newline if `contents`, or
+    // "<id> missing"
+    bool cat_file_batch(bool contents, std::istream& in, std::ostream& out);
+    // Commits reachable from `revisions` (branch names, HEAD, ids or
+    // --all), newest first; with `objects`, then their blobs as "<id> <path>"
+    bool rev_list(const std::vector<std::string>& revisions, bool objects, std::ostream& out);
+    // Imports a fast-import stream into a new pack; see fast_import.cpp
+    bool fast_import(std::istream& in);
+    // Writes the history reachable from `revisions` (branch names, HEAD or
+    // --all) as a fast-import stream, parents first
+    bool fast_export(const std::vector<std::string>& revisions, std::ostream& out);
+    // Checks that every object hashes to its id and that nothing a commit
+    // or reference names is missing or of the wrong type
+    bool fsck();
+    // action: run, start or stop. `task` limits run to one task; `auto_only`
+    // runs only the tasks whose heuristics say they are due.
+    bool maintenance(const std::string& action, const std::string& task = "", bool auto_only = false);
+
+    // Asks running parallel operations to stop before their next item.
+    // Safe to call from another thread.
+    void cancel() { cancellation.request_stop(); }
+    // Cancels on the first SIGINT (see utils::on_interrupt). The stop state
+    // is shared, so a late signal is harmless once this object is gone.
+    void cancel_on_interrupt() {
+        utils::on_interrupt([source = cancellation]() mutable { source.request_stop(); });
+    }
+
+    // Reads part of a blob in the large-object store without loading the rest
+    std::string read_large_range(const std::string& hash, std::uintmax_t offset, size_t length) const;
+
+    // Getters
+    std::vector<std::string> get_branches() const;
+    std::string get_current_branch() const { return current_branch; }
+    std::string get_head_commit() const;
+    bool is_repo_initialized() const { return is_initialized; }
+};
+
+extern template class BasicMiniGit<Sha1Policy>;
+extern template class BasicMiniGit<Sha256Policy>;
+
+using MiniGit = BasicMiniGit<Sha1Policy>;
+
+// Object format of the repository at `path`: sha1 unless it records
+// extensions.objectFormat, or if there is no repository there. False for
+// a format this build does not know.
+bool read_object_format(const std::string& path, ObjectFormat& format);
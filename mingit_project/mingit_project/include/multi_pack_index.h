@@ -0,0 +1,59 @@
+#pragma once
+
+#include "pack.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// One index over every pack in objects/pack (the multi-pack-index file):
+//
+//   "MGMI" | version (be32) | pack count (be32) | pack names (be16 length +
+//   name each) | fan-out: 256 x be32 | ids: n x ID_SIZE bytes, sorted |
+//   locations: n x (pack number be32, offset be64) | `Policy` hash of the
+//   above
+//
+// An object present in several packs is listed once, pointing at the first
+// pack in name order. Lookups map the file and binary-search it, so the
+// cost does not grow with the number of packs. open() rejects a file
+// whose trailing hash does not match.
+template <class Policy>
+class BasicMultiPackIndex {
+public:
+    using Pack = BasicPack<Policy>;
+    using PackIndex = BasicPackIndex<Policy>;
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    utils::MappedFile file;
+    std::vector<std::string> pack_names;
+    const unsigned char* fanout = nullptr;
+    const unsigned char* ids = nullptr;
+    const unsigned char* locations = nullptr;
+    std::uint32_t count = 0;
+
+public:
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    const std::vector<std::string>& get_pack_names() const { return pack_names; }
+    std::uint32_t size() const { return count; }
+    bool find(const unsigned char* id, std::uint32_t& pack, std::uint64_t& offset) const;
+
+    const unsigned char* id_at(std::uint32_t i) const { return ids + static_cast<size_t>(i) * ID_SIZE; }
+    std::uint32_t pack_at(std::uint32_t i) const;
+    std::uint64_t offset_at(std::uint32_t i) const;
+
+    // Writes an index covering `packs` to `path` (via a temporary file).
+    // Entries for packs that `base` already covers are taken from it rather
+    // than from their .idx files, and sorted runs are merged instead of
+    // resorted, so an update costs one linear pass. Packs dropped since
+    // `base` must have had their objects copied into one of `packs`.
+    static bool write(const std::string& path, const std::vector<const Pack*>& packs,
+                      const BasicMultiPackIndex* base = nullptr);
+};
+
+extern template class BasicMultiPackIndex<Sha1Policy>;
+extern template class BasicMultiPackIndex<Sha256Policy>;
+
+using MultiPackIndex = BasicMultiPackIndex<Sha1Policy>;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "utils.h"
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <openssl/evp.h>
+
+// Hash functions an object format can be built on. The binary formats
+// (pack index, multi-pack-index, commit-graph) and the pack store are
+// templates over one of these, so id widths are compile-time constants:
+// comparisons, copies and offset arithmetic cost the same for either, and
+// nothing branches on the format per operation. A repository's format is
+// read once, when it is opened (extensions.objectFormat).
+struct Sha1Policy {
+    static constexpr size_t DIGEST_SIZE = 20;
+    static constexpr const char* NAME = "sha1";
+    static const EVP_MD* algorithm() { return EVP_sha1(); }
+};
+
+struct Sha256Policy {
+    static constexpr size_t DIGEST_SIZE = 32;
+    static constexpr const char* NAME = "sha256";
+    static const EVP_MD* algorithm() { return EVP_sha256(); }
+};
+
+// Binary object id of a fixed width
+template <class Policy>
+class ObjectId {
+public:
+    static constexpr size_t SIZE = Policy::DIGEST_SIZE;
+    static constexpr size_t HEX_SIZE = 2 * SIZE;
+
+    std::array<unsigned char, SIZE> bytes{};
+
+    // False unless `hex` is exactly HEX_SIZE hex digits
+    static bool parse(const std::string& hex, ObjectId& id) {
+        return hex.size() == HEX_SIZE && utils::hex_decode(hex, id.bytes.data());
+    }
+
+    const unsigned char* data() const { return bytes.data(); }
+    std::string hex() const { return utils::hex_encode(bytes.data(), SIZE); }
+
+    friend auto operator<=>(const ObjectId&, const ObjectId&) = default;
+};
+
+// Incremental hash with `Policy`'s algorithm, for checksums of files
+// written piece by piece
+template <class Policy>
+class HashContext {
+private:
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context{EVP_MD_CTX_new(), EVP_MD_CTX_free};
+
+public:
+    HashContext() { reset(); }
+
+    void reset() { EVP_DigestInit_ex(context.get(), Policy::algorithm(), nullptr); }
+    void update(const void* data, size_t length) { EVP_DigestUpdate(context.get(), data, length); }
+    void finish(unsigned char* digest) { EVP_DigestFinal_ex(context.get(), digest, nullptr); }
+
+    static void digest(const void* data, size_t length, unsigned char* out) {
+        EVP_Digest(data, length, out, nullptr, Policy::algorithm(), nullptr);
+    }
+};
+
+enum class ObjectFormat { Sha1, Sha256 };
+
+// False for a name other than "sha1" or "sha256"
+bool parse_object_format(const std::string& name, ObjectFormat& format);
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "utils.h"
+#include "object_id.h"
+#include "pack_cache.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <string_view>
+
+// Length of the hex id in the header of blobs written before blobs became
+// name-independent; those predate other object formats, so it is SHA-1's
+constexpr size_t LEGACY_BLOB_ID_HEX_SIZE = 2 * Sha1Policy::DIGEST_SIZE;
+
+// True if a fan-out table (256 be32 cumulative counts) never decreases.
+// Lookups take their search range from two entries, so only then does
+// every range lie within the last entry, the object count.
+bool fanout_is_sorted(const unsigned char* fanout);
+
+// Object type recorded in each pack entry, derived from the object header
+enum class ObjectType : std::uint8_t {
+    None = 0,
+    Commit = 1,
+    Blob = 2,
+    Large = 3,
+    OfsDelta = 6,
+};
+
+ObjectType object_type_of(const std::string& data);
+const char* object_type_name(ObjectType type);
+
+// Type and size of an object, as far as they can be known without its
+// content: for blobs and large files the content size, for commits the
+// size of the serialized commit
+struct ObjectInfo {
+    ObjectType type = ObjectType::None;
+    std::uint64_t size = 0;
+};
+
+// Parses the header line(s) at the start of a serialized object of
+// `object_size` bytes (0 if unknown). False if `prefix` ends before the
+// header does, or the size needs the whole object (a commit of unknown
+// size).
+bool object_info_of(const std::string& prefix, std::uint64_t object_size, ObjectInfo& info);
+
+// Sorted object id -> offset table for one pack (pack-<checksum>.idx):
+//
+//   "MGIX" | version (be32) | fan-out: 256 x be32 cumulative counts by first
+//   id byte | ids: n x ID_SIZE bytes, sorted | offsets: n x be64 | pack
+//   checksum
+//
+// The file is mapped and searched in place. ID_SIZE is the digest size of
+// `Policy` (object_id.h): 20 bytes for SHA-1, 32 for SHA-256.
+template <class Policy>
+class BasicPackIndex {
+public:
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    utils::MappedFile file;
+    const unsigned char* fanout = nullptr;
+    const unsigned char* ids = nullptr;
+    const unsigned char* offsets = nullptr;
+    std::uint32_t count = 0;
+
+public:
+    bool open(const std::string& path);
+
+    std::uint32_t size() const { return count; }
+    const unsigned char* id_at(std::uint32_t i) const { return ids + static_cast<size_t>(i) * ID_SIZE; }
+    std::uint64_t offset_at(std::uint32_t i) const { return utils::get_be64(offsets + i * 8); }
+    bool find(const unsigned char* id, std::uint64_t& offset) const;
+};
+
+// A pack file (pack-<checksum>.pack): "MGPK" | version (be32) |
+// [dictionary size (be32) | dictionary, version 2], then one entry per
+// object:
+//
+//   type (1 byte) | object size (varint) | stored size (varint) |
+//   [base distance, delta size (varints), for OfsDelta] | zlib data
+//
+// and a trailing `Policy` hash of everything before it, which also names
+// the pack.
+// An OfsDelta entry holds a delta (delta.h) against the entry `base
+// distance` bytes earlier in the same pack; object size is the size of the
+// rebuilt object. Version 2 packs carry a zlib preset dictionary
+// (dictionary.h) that some entries' zlib data was compressed with; zlib
+// marks those streams itself. The file is read through windows from a
+// WindowManager.
+template <class Policy>
+class BasicPack {
+public:
+    using PackIndex = BasicPackIndex<Policy>;
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    struct EntryHeader {
+        ObjectType type = ObjectType::None;
+        std::uint64_t size = 0;
+        std::uint64_t stored = 0;
+        std::uint64_t base_offset = 0;
+        std::uint64_t inflated = 0; // size of the zlib data once inflated
+        size_t length = 0;
+    };
+
+    std::string name;
+    std::string zlib_dictionary;
+    std::uint64_t data_start = 0; // offset of the first entry
+    WindowedFile file;
+    PackIndex index;
+    WindowManager& windows;
+    DeltaBaseCache* cache;
+
+    bool read_header(std::uint64_t offset, EntryHeader& header) const;
+    bool inflate(std::uint64_t offset, const EntryHeader& header, std::string& out) const;
+    bool read_prefix(std::uint64_t offset, size_t length, std::string& out, size_t depth) const;
+
+public:
+    BasicPack(WindowManager& windows, DeltaBaseCache* cache);
+    ~BasicPack();
+    BasicPack(const BasicPack&) = delete;
+    BasicPack& operator=(const BasicPack&) = delete;
+
+    bool open(const std::string& pack_dir, const std::string& pack_name);
+
+    const std::string& get_name() const { return name; }
+    const PackIndex& get_index() const { return index; }
+    std::uint64_t size_on_disk() const { return file.size(); }
+
+    // Serialized object at `offset` with any delta chain resolved, or "" if
+    // an entry is damaged
+    std::string read(std::uint64_t offset) const;
+
+    // Type and size from the entry header and the object's first bytes.
+    // Only those bytes are inflated; for a delta, only the instructions
+    // producing them and the part of the base they copy.
+    bool read_info(std::uint64_t offset, ObjectInfo& info) const;
+
+    // Copies a non-delta entry exactly as stored (header and zlib data), for
+    // writing into another pack without recompressing. False for deltas,
+    // whose base distance only holds in this pack, entries compressed with
+    // this pack's dictionary, and damaged entries.
+    bool copy_raw(std::uint64_t offset, std::string& out) const;
+};
+
+// Streams objects into a new pack and writes its index on finish(). A
+// writer destroyed before finish() succeeds removes its temporary pack.
+template <class Policy>
+class BasicPackWriter {
+public:
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    std::string pack_dir;
+    std::string temp_path;
+    std::ofstream out;
+    HashContext<Policy> checksum;
+    std::uint64_t offset = 0;
+    int level;
+    std::string zlib_dictionary;
+    size_t dictionary_limit = 0;
+    std::vector<std::pair<std::string, std::uint64_t>> entries; // raw id -> offset
+
+    void write_raw(std::string_view bytes);
+
+public:
+    BasicPackWriter(const std::string& pack_dir, int level);
+    ~BasicPackWriter();
+    BasicPackWriter(const BasicPackWriter&) = delete;
+    BasicPackWriter& operator=(const BasicPackWriter&) = delete;
+
+    // Before begin(): objects up to `object_limit` bytes are compressed
+    // with the `preset` dictionary where that comes out smaller
+    void set_dictionary(std::string preset, size_t object_limit);
+    bool begin();
+    bool add(const std::string& hash, const std::string& data);
+    bool add_raw(const unsigned char* id, std::string_view entry);
+    // Stores `object` as a delta against the entry written at `base_offset`
+    bool add_delta(const std::string& hash, std::uint64_t base_offset, const std::string& delta,
+                   std::uint64_t object_size);
+    // Offset the next entry will be written at
+    std::uint64_t tell() const { return offset; }
+    size_t count() const { return entries.size(); }
+
+    // Returns the new pack's name, or "" on failure
+    std::string finish();
+};
+
+extern template class BasicPackIndex<Sha1Policy>;
+extern template class BasicPackIndex<Sha256Policy>;
+extern template class BasicPack<Sha1Policy>;
+extern template class BasicPack<Sha256Policy>;
+extern template class BasicPackWriter<Sha1Policy>;
+extern template class BasicPackWriter<Sha256Policy>;
+
+// The SHA-1 formats, the default object format
+using PackIndex = BasicPackIndex<Sha1Policy>;
+using Pack = BasicPack<Sha1Policy>;
+using PackWriter = BasicPackWriter<Sha1Policy>;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "pack.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Writes a set of objects to one new pack, storing each as a delta against
+// a similar object where that is smaller.
+//
+// Candidates are sorted by type, path hash and size (largest first), so
+// versions of the same file sit next to each other and deltas remove data
+// rather than add it. Each object is compared against the `window` objects
+// before it, skipping bases already `depth` deltas deep. The sorted list is
+// cut into fixed chunks that are searched in parallel, each with its own
+// window and memory limit; since a chunk's result depends only on its own
+// objects, the pack is identical whatever the thread count.
+template <class Policy>
+class BasicPackBuilder {
+public:
+    struct Object {
+        std::string hash;
+        ObjectType type = ObjectType::None;
+        std::uint64_t size = 0;
+        std::uint32_t path_hash = 0;
+    };
+
+    struct Options {
+        int level = 6;
+        unsigned window = 10;
+        unsigned depth = 50;
+        size_t window_memory = 0; // per search thread; 0 for no limit
+        // Objects up to this size may use a dictionary trained from the
+        // others; 0 for none
+        size_t dictionary_threshold = 0;
+    };
+
+    // Serialized object; "" if it cannot be read. Called concurrently.
+    using Reader = std::function<std::string(const std::string& hash)>;
+    // Stored entry to copy for an object that gets no delta, saving a
+    // recompression; false if there is none
+    using RawReader = std::function<bool(const std::string& hash, std::string& entry)>;
+
+private:
+    using PackWriter = BasicPackWriter<Policy>;
+    struct ChunkResult;
+
+    std::string pack_dir;
+    Options options;
+    std::vector<Object> objects;
+    size_t deltas = 0;
+
+    void search(size_t begin, size_t end, const Reader& read, ChunkResult& result) const;
+    std::string train_dictionary(const Reader& read) const;
+
+public:
+    BasicPackBuilder(const std::string& pack_dir, const Options& options);
+
+    void add(Object object) { objects.push_back(std::move(object)); }
+    size_t count() const { return objects.size(); }
+    size_t delta_count() const { return deltas; }
+
+    // Returns the new pack's name, or "" on failure
+    std::string write(const Reader& read, const RawReader& raw);
+
+    // Groups paths by their last characters, so files with the same name
+    // in different directories (and similar extensions) sort together
+    static std::uint32_t path_hash(const std::string& path);
+};
+
+extern template class BasicPackBuilder<Sha1Policy>;
+extern template class BasicPackBuilder<Sha256Policy>;
+
+using PackBuilder = BasicPackBuilder<Sha1Policy>;
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// A pack file opened for windowed access
+class WindowedFile {
+private:
+    std::string path;
+    std::uint64_t length = 0;
+#ifndef _WIN32
+    int fd = -1;
+#endif
+
+    friend class WindowManager;
+
+public:
+    WindowedFile() = default;
+    WindowedFile(const WindowedFile&) = delete;
+    WindowedFile& operator=(const WindowedFile&) = delete;
+    ~WindowedFile();
+
+    bool open(const std::string& filename);
+    void close();
+    std::uint64_t size() const { return length; }
+};
+
+// A mapped slice of a WindowedFile. It stays mapped while a caller holds it.
+class PackWindow {
+private:
+    std::uint64_t start = 0;
+    size_t length = 0;
+    const unsigned char* bytes = nullptr;
+    void* mapping = nullptr;
+    size_t mapping_length = 0;
+    std::string fallback;
+
+    friend class WindowManager;
+
+public:
+    PackWindow() = default;
+    PackWindow(const PackWindow&) = delete;
+    PackWindow& operator=(const PackWindow&) = delete;
+    ~PackWindow();
+
+    std::uint64_t offset() const { return start; }
+    size_t size() const { return length; }
+    // Pointer to file offset `at`, which must lie inside the window
+    const unsigned char* at(std::uint64_t at) const { return bytes + (at - start); }
+};
+
+// Maps pack files in windows of a fixed size instead of whole, so huge
+// packs need not fit in the address space. The total mapped size is kept
+// under a global limit by unmapping the least recently used windows that
+// no caller is holding. A request that runs past the window boundary gets
+// a larger window starting at the same aligned offset.
+class WindowManager {
+private:
+    using Key = std::pair<const WindowedFile*, std::uint64_t>;
+
+    size_t window_size;
+    size_t memory_limit;
+    size_t mapped = 0;
+    std::mutex mutex;
+    std::list<Key> lru; // most recently used first
+    std::map<Key, std::pair<std::shared_ptr<PackWindow>, std::list<Key>::iterator>> windows;
+
+    std::shared_ptr<PackWindow> map_window(const WindowedFile& file, std::uint64_t start, size_t length);
+    void evict_idle();
+
+public:
+    WindowManager(size_t window_size, size_t memory_limit);
+
+    // Window covering [offset, offset + length), clamped to the file's end;
+    // null if the range is outside the file or cannot be mapped
+    std::shared_ptr<const PackWindow> map(const WindowedFile& file, std::uint64_t offset, size_t length);
+
+    // Drops every window of `file`; call before closing it
+    void release(const WindowedFile& file);
+
+    size_t mapped_bytes();
+};
+
+// LRU cache of reconstructed delta bases, keyed by (pack, offset), so a
+// chain of deltas sharing a base only rebuilds that base once. Bounded by
+// the total size of the cached objects.
+class DeltaBaseCache {
+private:
+    using Key = std::pair<const void*, std::uint64_t>;
+
+    size_t memory_limit;
+    size_t used = 0;
+    std::mutex mutex;
+    std::list<Key> lru; // most recently used first
+    std::map<Key, std::pair<std::shared_ptr<const std::string>, std::list<Key>::iterator>> entries;
+
+public:
+    explicit DeltaBaseCache(size_t memory_limit);
+
+    std::shared_ptr<const std::string> get(const void* pack, std::uint64_t offset);
+    void put(const void* pack, std::uint64_t offset, std::shared_ptr<const std::string> data);
+    void clear();
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "pack.h"
+#include "multi_pack_index.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Location of a packed object
+template <class Policy>
+struct BasicPackLocation {
+    const BasicPack<Policy>* pack = nullptr;
+    std::uint64_t offset = 0;
+};
+
+// All packs under objects/pack. Lookups go through the multi-pack-index
+// when there is one, and only probe the individual index of packs written
+// since it was last updated. Every pack in a store shares one object
+// format, `Policy`.
+template <class Policy>
+class BasicPackStore {
+public:
+    using Pack = BasicPack<Policy>;
+    using MultiPackIndex = BasicMultiPackIndex<Policy>;
+    using PackLocation = BasicPackLocation<Policy>;
+    static constexpr size_t ID_SIZE = Policy::DIGEST_SIZE;
+
+private:
+    std::string pack_dir;
+    WindowManager windows;
+    DeltaBaseCache delta_cache;
+    std::vector<std::unique_ptr<Pack>> packs;
+    MultiPackIndex midx;
+    std::vector<const Pack*> midx_packs;   // midx pack number -> pack
+    std::vector<const Pack*> unindexed;    // packs the midx does not cover
+
+public:
+    // Packs are mapped in windows of `window_size` bytes, at most
+    // `window_limit` in total; `delta_cache_limit` bounds cached delta bases
+    BasicPackStore(const std::string& pack_dir, size_t window_size, size_t window_limit, size_t delta_cache_limit);
+
+    // (Re)scans the directory; call again after packs are added or removed
+    void load();
+
+    const std::string& directory() const { return pack_dir; }
+    const std::vector<std::unique_ptr<Pack>>& get_packs() const { return packs; }
+
+    bool find(const std::string& hash, PackLocation& location) const;
+    bool has(const std::string& hash) const;
+    std::string read(const std::string& hash) const;
+
+    // Packs to merge so that, ordered by object count, every remaining pack
+    // holds at least `factor` times as many objects as the one below it.
+    // `loose_objects` counts as a new pack at the bottom of the progression.
+    std::vector<const Pack*> geometric_rollup(unsigned factor, size_t loose_objects) const;
+
+    // Updates the multi-pack-index to cover every loaded pack except
+    // `excluded`, reusing the current one, and reloads
+    bool write_multi_pack_index(const std::set<std::string>& excluded = {});
+
+    // Deletes packs (after their objects were copied elsewhere) and reloads
+    void remove_packs(const std::set<std::string>& names);
+};
+
+extern template class BasicPackStore<Sha1Policy>;
+extern template class BasicPackStore<Sha256Policy>;
+
+using PackLocation = BasicPackLocation<Sha1Policy>;
+using PackStore = BasicPackStore<Sha1Policy>;
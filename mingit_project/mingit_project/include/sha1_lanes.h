@@ -0,0 +1,103 @@
+#pragma once
+
+#include "sha1_multi.h"
+#include <cstdint>
+#include <cstring>
+
+// SHA-1 compression written once over a vector type, for the kernel
+// sources that are built for one instruction set each. `V` supplies the
+// register type, its lane count and the 32-bit operations. Nothing here
+// may be an inline non-template function: a copy compiled for AVX-512
+// could be the one the linker keeps for everyone.
+namespace sha1_multi {
+    template <class V>
+    void compress_lanes(Lane* lanes) {
+        using Vec = typename V::Vec;
+        constexpr unsigned N = V::LANES;
+        alignas(64) std::uint32_t words[16][N];
+        alignas(64) std::uint32_t active[N];
+        alignas(64) std::uint32_t state[5][N];
+
+        std::uint64_t blocks = 0;
+        for (unsigned l = 0; l < N; ++l) {
+            blocks = lanes[l].total_blocks > blocks ? lanes[l].total_blocks : blocks;
+            for (unsigned i = 0; i < 5; ++i) {
+                state[i][l] = lanes[l].state[i];
+            }
+        }
+        Vec h0 = V::load(state[0]), h1 = V::load(state[1]), h2 = V::load(state[2]);
+        Vec h3 = V::load(state[3]), h4 = V::load(state[4]);
+
+        for (std::uint64_t b = 0; b < blocks; ++b) {
+            // Transpose: word t of every lane's block into one register.
+            // Idle lanes hash a block of zeros that is then discarded.
+            static const unsigned char zeros[64] = {};
+            for (unsigned l = 0; l < N; ++l) {
+                const Lane& lane = lanes[l];
+                const unsigned char* block = b < lane.full_blocks ? lane.data + 64 * b
+                                           : b < lane.total_blocks ? lane.tail + 64 * (b - lane.full_blocks)
+                                           : zeros;
+                active[l] = block != zeros ? ~0u : 0u;
+                for (unsigned t = 0; t < 16; ++t) {
+                    std::uint32_t word;
+                    std::memcpy(&word, block + 4 * t, 4);
+                    words[t][l] = __builtin_bswap32(word);
+                }
+            }
+
+            Vec w[16];
+            for (unsigned t = 0; t < 16; ++t) {
+                w[t] = V::load(words[t]);
+            }
+            auto schedule = [&w](unsigned t) {
+                if (t < 16) {
+                    return w[t];
+                }
+                Vec x = V::xor3(w[(t - 3) & 15], w[(t - 8) & 15], w[(t - 14) & 15]);
+                w[t & 15] = V::template rotl<1>(V::xor2(x, w[t & 15]));
+                return w[t & 15];
+            };
+
+            Vec a = h0, b2 = h1, c = h2, d = h3, e = h4;
+            auto round = [&](Vec f, std::uint32_t k, Vec wt) {
+                Vec temp = V::add(V::add(V::template rotl<5>(a), f), V::add(V::add(e, V::set1(k)), wt));
+                e = d;
+                d = c;
+                c = V::template rotl<30>(b2);
+                b2 = a;
+                a = temp;
+            };
+            for (unsigned t = 0; t < 20; ++t) {
+                round(V::choose(b2, c, d), 0x5A827999, schedule(t));
+            }
+            for (unsigned t = 20; t < 40; ++t) {
+                round(V::xor3(b2, c, d), 0x6ED9EBA1, schedule(t));
+            }
+            for (unsigned t = 40; t < 60; ++t) {
+                round(V::majority(b2, c, d), 0x8F1BBCDC, schedule(t));
+            }
+            for (unsigned t = 60; t < 80; ++t) {
+                round(V::xor3(b2, c, d), 0xCA62C1D6, schedule(t));
+            }
+
+            // Lanes past the end of their message keep their state
+            Vec mask = V::load(active);
+            h0 = V::select(mask, V::add(h0, a), h0);
+            h1 = V::select(mask, V::add(h1, b2), h1);
+            h2 = V::select(mask, V::add(h2, c), h2);
+            h3 = V::select(mask, V::add(h3, d), h3);
+            h4 = V::select(mask, V::add(h4, e), h4);
+        }
+
+        V::store(state[0], h0);
+        V::store(state[1], h1);
+        V::store(state[2], h2);
+        V::store(state[3], h3);
+        V::store(state[4], h4);
+        for (unsigned l = 0; l < N; ++l) {
+            for (unsigned i = 0; i < 5; ++i) {
+                lanes[l].state[i] = state[i][l];
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SHA-1 of many independent inputs at once. One input cannot be hashed in
+// parallel, as every block depends on the one before, but the rounds of
+// several inputs can run side by side in the lanes of a vector register:
+// 8 with AVX2, 16 with AVX-512. For the small files that make up most of
+// a source tree this does far more per instruction than one OpenSSL call
+// per file. On CPUs with the SHA extensions, OpenSSL hashes one input
+// faster than 8 AVX2 lanes do, so there only AVX-512 is used.
+namespace sha1_multi {
+    // One message in a vector kernel call. `data` holds `full_blocks`
+    // whole blocks; the padded remainder follows from `tail`. A lane with
+    // `total_blocks` 0 is idle.
+    struct Lane {
+        const unsigned char* data = nullptr;
+        std::uint64_t full_blocks = 0;
+        std::uint64_t total_blocks = 0;
+        unsigned char tail[128] = {};
+        std::uint32_t state[5] = {};
+    };
+
+    // Inputs hashed together by hash(); 1 when it hashes one at a time
+    size_t lanes();
+
+    // Hex digests of `inputs`, in order. Inputs are grouped by length so
+    // lanes finish together.
+    std::vector<std::string> hash(const std::vector<std::string_view>& inputs);
+    // hash() through a given kernel of `lanes` lanes, whatever is bound
+    std::vector<std::string> hash_with(void (*compress)(Lane*), size_t lanes,
+                                       const std::vector<std::string_view>& inputs);
+
+    // Ids of `type` objects with these payloads: each is hashed behind its
+    // "<type> <length>\0" header (see utils::hash_object)
+    std::vector<std::string> hash_objects(const std::string& type, const std::vector<std::string_view>& payloads);
+
+    // Vector kernels, bound in cpu::kernels() where the CPU supports them.
+    // Each runs up to 8 or 16 lanes to the end of their messages.
+    void compress_avx2(Lane* lanes);
+    void compress_avx512(Lane* lanes);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "executor.h"
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Lazily started coroutine. Nothing runs until the task is awaited (or
+// passed to sync_wait); the awaiting coroutine is resumed when it finishes.
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Blocks a thread until `count` detached coroutines have finished.
+class Countdown {
+private:
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+
+public:
+    explicit Countdown(size_t count) : remaining(count) {}
+
+    void arrive() {
+        // Notify under the lock: the waiter owns this object and may destroy
+        // it as soon as it can observe remaining == 0
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) done.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+};
+
+// Eagerly started, self-destroying coroutine used to bridge tasks into
+// blocking code.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+inline DetachedTask run_detached(Task<> task, Countdown& countdown, std::exception_ptr& error,
+                                 std::mutex& error_mutex) {
+    {
+        // Destroy the task's frame before signalling, so nothing it owns
+        // outlives the waiter
+        Task<> owned = std::move(task);
+        try {
+            co_await owned;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+        }
+    }
+    countdown.arrive();
+}
+
+} // namespace detail
+
+// Runs all tasks concurrently and blocks until every one has finished.
+// The first exception thrown by any task is rethrown afterwards.
+inline void sync_wait_all(std::vector<Task<>> tasks) {
+    detail::Countdown countdown(tasks.size());
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    for (auto& task : tasks) {
+        detail::run_detached(std::move(task), countdown, error, error_mutex);
+    }
+    countdown.wait();
+    if (error) std::rethrow_exception(error);
+}
+
+template <typename T>
+T sync_wait(Task<T> task) {
+    std::optional<T> result;
+    auto wrapper = [&]() -> Task<> { result.emplace(co_await task); };
+    std::vector<Task<>> tasks;
+    tasks.push_back(wrapper());
+    sync_wait_all(std::move(tasks));
+    return std::move(*result);
+}
+
+inline void sync_wait(Task<> task) {
+    std::vector<Task<>> tasks;
+    tasks.push_back(std::move(task));
+    sync_wait_all(std::move(tasks));
+}
+
+// Runs body(i) for every i in [0, count) on the executor with at most
+// `limit` items in flight. Items are only started when a slot frees up, so
+// a slow stage holds back the ones that feed it instead of piling up work.
+// Must not be called from an executor thread. Returns false if `stop` was
+// requested before every item started; items already running finish.
+template <typename Body>
+bool for_each_bounded(Executor& executor, size_t count, size_t limit, Body body,
+                      std::stop_token stop = {}) {
+    if (count == 0) {
+        return true;
+    }
+    
+    std::atomic<size_t> next{0};
+    std::atomic<bool> cancelled{false};
+    auto worker = [&]() -> Task<> {
+        co_await executor.schedule();
+        for (size_t i = next++; i < count; i = next++) {
+            if (stop.stop_requested()) {
+                cancelled = true;
+                break;
+            }
+            co_await body(i);
+        }
+    };
+
+    size_t workers = std::max<size_t>(1, std::min(limit, count));
+    std::vector<Task<>> tasks;
+    for (size_t i = 0; i < workers; ++i) {
+        tasks.push_back(worker());
+    }
+    sync_wait_all(std::move(tasks));
+    return !cancelled;
+}
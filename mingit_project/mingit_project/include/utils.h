@@ -8,21 +8,112 @@
 #include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <functional>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 #include <iomanip>
 
 namespace utils {
     // File operations
     std::string read_file(const std::string& filename);
     bool write_file(const std::string& filename, const std::string& content);
+    // Writes to a temporary beside `filename` and renames it into place, so
+    // the file is either absent or complete
+    bool write_file_atomic(const std::string& filename, const std::string& content);
+    // A fresh name beside `path` to write before renaming onto it; unique
+    // across threads and processes
+    std::string temp_path(const std::string& path);
+    // Renames `from` onto `to`, removing `from` if that fails
+    bool rename_file(const std::string& from, const std::string& to);
     bool file_exists(const std::string& filename);
     bool directory_exists(const std::string& path);
     void create_directory(const std::string& path);
     std::vector<std::string> list_files(const std::string& directory);
+    std::uintmax_t file_size(const std::string& filename);
+    std::uint64_t file_inode(const std::string& filename);
+    std::string read_file_range(const std::string& filename, std::uintmax_t offset, size_t length);
     
-    // Hashing
-    std::string sha1_hash(const std::string& input);
+    // Hashing. `algorithm` is the object format's hash (see object_id.h).
     std::string hex_encode(const unsigned char* data, size_t length);
+    // `header` is hashed ahead of the file's contents
+    std::string hash_file(const EVP_MD* algorithm, const std::string& filename, const std::string& header = "");
+    // hash_file that also copies the file to `to` in the same pass; "" if
+    // either file fails
+    std::string hash_copy_file(const EVP_MD* algorithm, const std::string& from, const std::string& to,
+                               const std::string& header);
+    bool hex_decode(const std::string& hex, unsigned char* out);
+
+    // Object ids are the hash of "<type> <length>\0" followed by the
+    // payload, as in git, so objects of different types never share an id
+    std::string object_header(const std::string& type, size_t length);
+    std::string hash_object(const EVP_MD* algorithm, const std::string& type, const std::string& payload);
+
+    // Output stream that feeds everything written to it into a hash, so an
+    // object can be hashed while it is serialized without building a copy.
+    class HashStream : public std::ostream {
+    private:
+        class Buffer : public std::streambuf {
+        public:
+            EVP_MD_CTX* ctx;
+            explicit Buffer(const EVP_MD* algorithm);
+            ~Buffer() override;
+            Buffer(const Buffer&) = delete;
+            Buffer& operator=(const Buffer&) = delete;
+        protected:
+            int_type overflow(int_type ch) override;
+            std::streamsize xsputn(const char* s, std::streamsize n) override;
+        };
+        Buffer buffer;
+
+    public:
+        // `header` is hashed before anything written to the stream
+        explicit HashStream(const EVP_MD* algorithm, const std::string& header = "");
+        std::string hex_digest();
+    };
+    
+    // Compression (zlib)
+    std::string compress(const std::string& data, int level);
+    // With a zlib preset dictionary, which the reader must supply too
+    std::string compress(const std::string& data, int level, const std::string& dictionary);
+    std::string decompress(const std::string& data);
+    std::string decompress(const unsigned char* data, size_t length, size_t expected_size,
+                           const std::string& dictionary = "");
+    // At most the first `limit` bytes of a zlib stream, which may itself be
+    // cut short; "" on error
+    std::string decompress_prefix(const unsigned char* data, size_t length, size_t limit,
+                                  const std::string& dictionary = "");
+    bool is_compressed(const std::string& data);
+    
+    // Big-endian integers and varints for the binary pack formats
+    void put_be32(std::string& out, std::uint32_t value);
+    void put_be64(std::string& out, std::uint64_t value);
+    std::uint32_t get_be32(const unsigned char* data);
+    std::uint64_t get_be64(const unsigned char* data);
+    void put_varint(std::string& out, std::uint64_t value);
+    // Returns bytes consumed, or 0 if the varint runs past `end`
+    size_t get_varint(const unsigned char* data, const unsigned char* end, std::uint64_t& value);
+    
+    // Read-only view of a whole file, memory-mapped where the platform
+    // supports it and read into memory otherwise.
+    class MappedFile {
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+        void* mapping = nullptr;
+        std::string fallback;
+
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool open(const std::string& filename);
+        void close();
+        bool is_open() const { return bytes != nullptr; }
+        const unsigned char* data() const { return bytes; }
+        size_t size() const { return length; }
+    };
     
     // String operations
     std::vector<std::string> split(const std::string& str, char delimiter);
@@ -37,9 +128,18 @@ namespace utils {
     std::vector<std::string> compute_diff(const std::string& old_content, const std::string& new_content);
     std::string apply_patch(const std::string& content, const std::vector<std::string>& patch);
     
-    // Color output (for terminal)
+    // Calls `callback` once on the first SIGINT, from a thread of its own
+    // rather than the signal handler, so it may take locks. A second SIGINT
+    // ends the process with status 130. Call at most once per process.
+    void on_interrupt(std::function<void()> callback);
+    
+    // Color output (for terminal). Errors and warnings go to stderr, so
+    // they never land in a stream a command writes to stdout.
     void print_success(const std::string& message);
     void print_error(const std::string& message);
     void print_warning(const std::string& message);
     void print_info(const std::string& message);
+    // Plain "error: <message>" on stderr, for commands whose stdout is a
+    // stream that another program reads
+    void report_error(const std::string& message);
 } 
\ No newline at end of file
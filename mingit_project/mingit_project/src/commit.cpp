@@ -1,5 +1,38 @@
  #include "commit.h"
 #include "utils.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+// Discards what is written and counts it, to learn a body's length before
+// hashing it behind its object header
+class CountingBuffer : public std::streambuf {
+public:
+    size_t count = 0;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            ++count;
+        }
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        count += static_cast<size_t>(n);
+        return n;
+    }
+};
+
+// The decimal number making up all of `text`; false on anything else, so
+// a corrupt object reads as nullptr instead of throwing
+template <typename T>
+bool parse_number(const std::string& text, T& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && error == std::errc() && end == text.data() + text.size();
+}
+
+} // namespace
 
 Commit::Commit(const std::string& msg, const std::string& auth) 
     : message(msg), author(auth) {
@@ -20,23 +53,39 @@ void Commit::remove_file(const std::string& filename) {
     file_blobs.erase(filename);
 }
 
-std::string Commit::to_string() const {
-    std::stringstream ss;
-    ss << "commit " << hash << "\n";
-    ss << "message " << message << "\n";
-    ss << "author " << author << "\n";
-    ss << "timestamp " << timestamp << "\n";
-    ss << "parents " << parent_hashes.size() << "\n";
+// Everything after the "commit <hash>" line. This is the canonical form the
+// commit id is computed over, so parents and files are part of the identity.
+void Commit::write_body(std::ostream& out) const {
+    out << "message " << message << "\n";
+    out << "author " << author << "\n";
+    out << "timestamp " << timestamp << "\n";
+    out << "parents " << parent_hashes.size() << "\n";
     
     for (const auto& parent : parent_hashes) {
-        ss << "parent " << parent << "\n";
+        out << "parent " << parent << "\n";
     }
     
-    ss << "files " << file_blobs.size() << "\n";
+    out << "files " << file_blobs.size() << "\n";
     for (const auto& [filename, blob_hash] : file_blobs) {
-        ss << "file " << filename << " " << blob_hash << "\n";
+        out << "file " << filename << " " << blob_hash << "\n";
     }
-    
+}
+
+// Hash of "commit <length>\0" + body. The body is serialized twice, once
+// to measure it, rather than copied.
+std::string Commit::compute_hash(const EVP_MD* algorithm) const {
+    CountingBuffer counter;
+    std::ostream measure(&counter);
+    write_body(measure);
+    utils::HashStream hasher(algorithm, utils::object_header("commit", counter.count));
+    write_body(hasher);
+    return hasher.hex_digest();
+}
+
+std::string Commit::to_string() const {
+    std::stringstream ss;
+    ss << "commit " << hash << "\n";
+    write_body(ss);
     return ss.str();
 }
 
@@ -75,31 +124,40 @@ std::shared_ptr<Commit> Commit::from_string(const std::string& data) {
         return nullptr;
     }
     
-    std::time_t timestamp = utils::string_to_timestamp(timestamp_line.substr(10));
+    long long timestamp = 0;
+    if (!parse_number(timestamp_line.substr(10), timestamp)) {
+        return nullptr;
+    }
     
     if (!parents_count_line.starts_with("parents ")) {
         return nullptr;
     }
     
-    size_t parents_count = std::stoul(parents_count_line.substr(8));
+    size_t parents_count = 0;
+    if (!parse_number(parents_count_line.substr(8), parents_count) || parents_count > lines.size() - 5) {
+        return nullptr;
+    }
     
     auto commit = std::make_shared<Commit>(message, author);
     commit->set_hash(hash);
-    commit->timestamp = timestamp;
+    commit->timestamp = static_cast<std::time_t>(timestamp);
     
     // Parse parents
     size_t line_index = 5;
-    for (size_t i = 0; i < parents_count && line_index < lines.size(); ++i) {
-        if (lines[line_index].starts_with("parent ")) {
-            std::string parent_hash = lines[line_index].substr(7);
-            commit->add_parent(parent_hash);
+    for (size_t i = 0; i < parents_count; ++i) {
+        if (!lines[line_index].starts_with("parent ")) {
+            return nullptr;
         }
+        commit->add_parent(lines[line_index].substr(7));
         ++line_index;
     }
     
     // Parse files
     if (line_index < lines.size() && lines[line_index].starts_with("files ")) {
-        size_t files_count = std::stoul(lines[line_index].substr(6));
+        size_t files_count = 0;
+        if (!parse_number(lines[line_index].substr(6), files_count)) {
+            return nullptr;
+        }
         ++line_index;
         
         for (size_t i = 0; i < files_count && line_index < lines.size(); ++i) {
@@ -0,0 +1,513 @@
+#include "commit_graph.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace {
+
+const char GRAPH_MAGIC[4] = {'M', 'G', 'C', 'G'};
+const std::uint32_t GRAPH_VERSION = 2;
+const size_t FANOUT_SIZE = 256 * 4;
+const size_t RECORD_SIZE = 20;
+
+// Holds commit-graph-chain.lock, created exclusively so that one writer at
+// a time replaces the chain. The new listing is written into the lock and
+// renamed onto the chain; an abandoned update removes the lock.
+class ChainLock {
+private:
+    std::string path;
+    std::FILE* file;
+
+public:
+    explicit ChainLock(const std::string& path) : path(path), file(std::fopen(path.c_str(), "wx")) {}
+
+    ~ChainLock() {
+        if (file) {
+            std::fclose(file);
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    bool is_held() const { return file != nullptr; }
+
+    bool commit(const std::string& listing, const std::string& target) {
+        bool written = std::fwrite(listing.data(), 1, listing.size(), file) == listing.size();
+        written = std::fclose(file) == 0 && written;
+        file = nullptr;
+        if (!written) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            return false;
+        }
+        return utils::rename_file(path, target);
+    }
+};
+
+} // namespace
+
+template <class Policy>
+bool BasicCommitGraph<Policy>::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    // Version 1 files predate layers and have no base count
+    const unsigned char* data = file.data();
+    std::uint32_t version = file.size() >= 8 ? utils::get_be32(data + 4) : 0;
+    size_t header = version == 1 ? 8 : 12;
+    if ((version != 1 && version != GRAPH_VERSION) || file.size() < header + FANOUT_SIZE + ID_SIZE ||
+        std::memcmp(data, GRAPH_MAGIC, 4) != 0) {
+        close();
+        return false;
+    }
+
+    // find() trusts both the count and the fan-out, as in PackIndex
+    base = version == 1 ? 0 : utils::get_be32(data + 8);
+    fanout = data + header;
+    count = utils::get_be32(fanout + 255 * 4);
+    size_t fixed = header + FANOUT_SIZE + static_cast<size_t>(count) * (ID_SIZE + RECORD_SIZE) + ID_SIZE;
+    if (file.size() < fixed || (file.size() - fixed) % 4 != 0 || !fanout_is_sorted(fanout)) {
+        close();
+        return false;
+    }
+    ids = fanout + FANOUT_SIZE;
+    records = ids + static_cast<size_t>(count) * ID_SIZE;
+    edges = records + static_cast<size_t>(count) * RECORD_SIZE;
+    edge_count = static_cast<std::uint32_t>((file.size() - fixed) / 4);
+
+    unsigned char digest[ID_SIZE];
+    HashContext<Policy>::digest(data, file.size() - ID_SIZE, digest);
+    if (static_cast<std::uint64_t>(base) + count >= NO_PARENT ||
+        std::memcmp(digest, data + file.size() - ID_SIZE, ID_SIZE) != 0) {
+        close();
+        return false;
+    }
+
+    // Parents are used as indexes, so each must be a position in this layer
+    // or below. One in this layer must also have a lower generation, which
+    // keeps a damaged file from sending history walks round in a cycle.
+    for (std::uint32_t position = base; position < base + count; ++position) {
+        const unsigned char* record = records + static_cast<size_t>(position - base) * RECORD_SIZE;
+        std::uint32_t second = utils::get_be32(record + 4);
+        if (second != NO_PARENT && (second & EXTRA_EDGES) && (second & ~EXTRA_EDGES) >= edge_count) {
+            close();
+            return false;
+        }
+        for (std::uint32_t parent : parents(position)) {
+            if (parent >= base + count || (parent >= base && generation(parent) >= generation(position))) {
+                close();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <class Policy>
+void BasicCommitGraph<Policy>::close() {
+    file.close();
+    fanout = ids = records = edges = nullptr;
+    base = count = edge_count = 0;
+}
+
+template <class Policy>
+bool BasicCommitGraph<Policy>::find(const std::string& hash, std::uint32_t& position) const {
+    unsigned char id[ID_SIZE];
+    if (!file.is_open() || hash.size() != ID_SIZE * 2 || !utils::hex_decode(hash, id)) {
+        return false;
+    }
+
+    std::uint32_t low = id[0] == 0 ? 0 : utils::get_be32(fanout + (id[0] - 1) * 4);
+    std::uint32_t high = utils::get_be32(fanout + id[0] * 4);
+    while (low < high) {
+        std::uint32_t mid = low + (high - low) / 2;
+        int cmp = std::memcmp(ids + static_cast<size_t>(mid) * ID_SIZE, id, ID_SIZE);
+        if (cmp == 0) {
+            position = base + mid;
+            return true;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+template <class Policy>
+std::string BasicCommitGraph<Policy>::hash_at(std::uint32_t position) const {
+    if (position < base || position - base >= count) {
+        return "";
+    }
+    return utils::hex_encode(ids + static_cast<size_t>(position - base) * ID_SIZE, ID_SIZE);
+}
+
+template <class Policy>
+std::vector<std::uint32_t> BasicCommitGraph<Policy>::parents(std::uint32_t position) const {
+    std::vector<std::uint32_t> result;
+    if (position < base || position - base >= count) {
+        return result;
+    }
+    const unsigned char* record = records + static_cast<size_t>(position - base) * RECORD_SIZE;
+
+    std::uint32_t first = utils::get_be32(record);
+    if (first == NO_PARENT) {
+        return result;
+    }
+    result.push_back(first);
+
+    std::uint32_t second = utils::get_be32(record + 4);
+    if (second == NO_PARENT) {
+        return result;
+    }
+    if (!(second & EXTRA_EDGES)) {
+        result.push_back(second);
+        return result;
+    }
+    for (std::uint32_t i = second & ~EXTRA_EDGES; i < edge_count; ++i) {
+        std::uint32_t edge = utils::get_be32(edges + static_cast<size_t>(i) * 4);
+        result.push_back(edge & ~EXTRA_EDGES);
+        if (edge & EXTRA_EDGES) {
+            break;
+        }
+    }
+    return result;
+}
+
+template <class Policy>
+std::uint32_t BasicCommitGraph<Policy>::generation(std::uint32_t position) const {
+    if (position < base || position - base >= count) {
+        return 0;
+    }
+    return utils::get_be32(records + static_cast<size_t>(position - base) * RECORD_SIZE + 8);
+}
+
+template <class Policy>
+std::time_t BasicCommitGraph<Policy>::timestamp(std::uint32_t position) const {
+    if (position < base || position - base >= count) {
+        return 0;
+    }
+    return static_cast<std::time_t>(utils::get_be64(records + static_cast<size_t>(position - base) * RECORD_SIZE + 12));
+}
+
+template <class Policy>
+std::string BasicCommitGraph<Policy>::build(const std::vector<Entry>& commits, std::uint32_t base_count,
+                               const BaseLookup& lookup) {
+    std::vector<const Entry*> sorted;
+    for (const auto& entry : commits) {
+        if (entry.hash.size() == ID_SIZE * 2) {
+            sorted.push_back(&entry);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->hash < b->hash; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                             [](const Entry* a, const Entry* b) { return a->hash == b->hash; }),
+                 sorted.end());
+
+    // Lower-case hex sorts like the binary ids it encodes
+    std::map<std::string, std::uint32_t> positions;
+    for (std::uint32_t i = 0; i < sorted.size(); ++i) {
+        positions[sorted[i]->hash] = i;
+    }
+    // Parents are stored as chain positions; `base_generation` keeps the
+    // generations of those below this layer
+    std::vector<std::vector<std::uint32_t>> parents(sorted.size());
+    std::map<std::uint32_t, std::uint32_t> base_generation;
+    for (std::uint32_t i = 0; i < sorted.size(); ++i) {
+        for (const auto& parent : sorted[i]->parents) {
+            auto it = positions.find(parent);
+            std::uint32_t position = 0;
+            std::uint32_t generation = 0;
+            if (it != positions.end()) {
+                parents[i].push_back(base_count + it->second);
+            } else if (lookup && lookup(parent, position, generation) && position < base_count) {
+                parents[i].push_back(position);
+                base_generation[position] = std::max<std::uint32_t>(generation, 1);
+            }
+        }
+    }
+
+    // Generations, computed depth-first with an explicit stack since
+    // histories can be far deeper than the call stack
+    std::vector<std::uint32_t> generations(sorted.size(), 0);
+    auto generation_of = [&](std::uint32_t parent) {
+        return parent < base_count ? base_generation[parent] : generations[parent - base_count];
+    };
+    for (std::uint32_t root = 0; root < sorted.size(); ++root) {
+        std::vector<std::uint32_t> stack{root};
+        while (!stack.empty()) {
+            std::uint32_t current = stack.back();
+            if (generations[current] != 0) {
+                stack.pop_back();
+                continue;
+            }
+            bool ready = true;
+            std::uint32_t highest = 0;
+            for (std::uint32_t parent : parents[current]) {
+                if (generation_of(parent) == 0) {
+                    stack.push_back(parent - base_count);
+                    ready = false;
+                } else {
+                    highest = std::max(highest, generation_of(parent));
+                }
+            }
+            if (ready) {
+                generations[current] = highest + 1;
+                stack.pop_back();
+            }
+        }
+    }
+
+    std::string out(GRAPH_MAGIC, 4);
+    utils::put_be32(out, GRAPH_VERSION);
+    utils::put_be32(out, base_count);
+    std::uint32_t fanout[256] = {};
+    std::vector<unsigned char> raw(sorted.size() * ID_SIZE);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (!utils::hex_decode(sorted[i]->hash, raw.data() + i * ID_SIZE)) {
+            return "";
+        }
+        ++fanout[raw[i * ID_SIZE]];
+    }
+    std::uint32_t running = 0;
+    for (std::uint32_t bucket : fanout) {
+        running += bucket;
+        utils::put_be32(out, running);
+    }
+    out.append(reinterpret_cast<const char*>(raw.data()), raw.size());
+
+    std::string extra;
+    std::uint32_t extra_count = 0;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const auto& list = parents[i];
+        utils::put_be32(out, list.empty() ? NO_PARENT : list[0]);
+        if (list.size() <= 2) {
+            utils::put_be32(out, list.size() == 2 ? list[1] : NO_PARENT);
+        } else {
+            utils::put_be32(out, EXTRA_EDGES | extra_count);
+            for (size_t p = 1; p < list.size(); ++p, ++extra_count) {
+                utils::put_be32(extra, p + 1 == list.size() ? (list[p] | EXTRA_EDGES) : list[p]);
+            }
+        }
+        utils::put_be32(out, generations[i]);
+        utils::put_be64(out, static_cast<std::uint64_t>(sorted[i]->timestamp));
+    }
+    out += extra;
+
+    unsigned char digest[ID_SIZE];
+    HashContext<Policy>::digest(out.data(), out.size(), digest);
+    out.append(reinterpret_cast<const char*>(digest), ID_SIZE);
+
+    return out;
+}
+
+template <class Policy>
+BasicCommitGraphChain<Policy>::BasicCommitGraphChain(const std::string& info_dir) : info_dir(info_dir) {
+}
+
+template <class Policy>
+void BasicCommitGraphChain<Policy>::load() {
+    names.clear();
+    layers.clear();
+
+    std::string chain = utils::read_file(info_dir + "/commit-graphs/commit-graph-chain");
+    if (chain.empty()) {
+        auto single = std::make_unique<CommitGraph>();
+        if (single->open(info_dir + "/commit-graph")) {
+            names.push_back("");
+            layers.push_back(std::move(single));
+        }
+        return;
+    }
+
+    // Each layer must start where the one below ends; a broken chain is
+    // used only up to the first bad layer
+    std::uint32_t total = 0;
+    for (const auto& line : utils::split(chain, '\n')) {
+        std::string name = utils::trim(line);
+        if (name.empty()) {
+            continue;
+        }
+        auto layer = std::make_unique<CommitGraph>();
+        if (!layer->open(info_dir + "/commit-graphs/" + name + ".graph") || layer->base_count() != total) {
+            break;
+        }
+        total += layer->size();
+        names.push_back(name);
+        layers.push_back(std::move(layer));
+    }
+}
+
+template <class Policy>
+std::uint32_t BasicCommitGraphChain<Policy>::size() const {
+    return layers.empty() ? 0 : layers.back()->base_count() + layers.back()->size();
+}
+
+template <class Policy>
+const BasicCommitGraph<Policy>* BasicCommitGraphChain<Policy>::layer_of(std::uint32_t position) const {
+    if (position >= size()) {
+        return nullptr;
+    }
+    for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
+        if (position >= (*it)->base_count()) {
+            return it->get();
+        }
+    }
+    return nullptr;
+}
+
+template <class Policy>
+bool BasicCommitGraphChain<Policy>::find_below(const std::string& hash, size_t layer_limit,
+                                               std::uint32_t& position) const {
+    for (size_t i = std::min(layer_limit, layers.size()); i-- > 0;) {
+        if (layers[i]->find(hash, position)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Policy>
+bool BasicCommitGraphChain<Policy>::find(const std::string& hash, std::uint32_t& position) const {
+    return find_below(hash, layers.size(), position);
+}
+
+template <class Policy>
+std::string BasicCommitGraphChain<Policy>::hash_at(std::uint32_t position) const {
+    const CommitGraph* layer = layer_of(position);
+    return layer ? layer->hash_at(position) : std::string{};
+}
+
+template <class Policy>
+std::vector<std::uint32_t> BasicCommitGraphChain<Policy>::parents(std::uint32_t position) const {
+    const CommitGraph* layer = layer_of(position);
+    return layer ? layer->parents(position) : std::vector<std::uint32_t>{};
+}
+
+template <class Policy>
+std::uint32_t BasicCommitGraphChain<Policy>::generation(std::uint32_t position) const {
+    const CommitGraph* layer = layer_of(position);
+    return layer ? layer->generation(position) : 0;
+}
+
+template <class Policy>
+std::time_t BasicCommitGraphChain<Policy>::timestamp(std::uint32_t position) const {
+    const CommitGraph* layer = layer_of(position);
+    return layer ? layer->timestamp(position) : 0;
+}
+
+template <class Policy>
+std::vector<CommitGraphEntry> BasicCommitGraphChain<Policy>::layer_entries(size_t layer) const {
+    const CommitGraph& graph = *layers[layer];
+    std::vector<CommitGraphEntry> entries;
+    for (std::uint32_t position = graph.base_count(); position < graph.base_count() + graph.size(); ++position) {
+        CommitGraphEntry entry;
+        entry.hash = graph.hash_at(position);
+        entry.timestamp = graph.timestamp(position);
+        for (std::uint32_t parent : graph.parents(position)) {
+            entry.parents.push_back(hash_at(parent));
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+template <class Policy>
+bool BasicCommitGraphChain<Policy>::append(const std::vector<CommitGraphEntry>& commits, unsigned size_ratio) {
+    if (commits.empty()) {
+        return true;
+    }
+
+    // Another writer holds the chain; the commits are picked up next time
+    std::string dir = info_dir + "/commit-graphs";
+    utils::create_directory(dir);
+    std::string chain_path = dir + "/commit-graph-chain";
+    ChainLock lock(chain_path + ".lock");
+    if (!lock.is_held()) {
+        return false;
+    }
+
+    // The chain may have moved since it was loaded, possibly covering some
+    // of `commits` already
+    load();
+    std::vector<CommitGraphEntry> entries;
+    std::uint32_t position = 0;
+    for (const auto& commit : commits) {
+        if (!find(commit.hash, position)) {
+            entries.push_back(commit);
+        }
+    }
+    if (entries.empty()) {
+        return true;
+    }
+
+    // Fold layers into the new one while it is more than 1/ratio the size
+    // of the layer below, so sizes grow geometrically down the chain. A
+    // legacy single file cannot be listed in the chain, so it is always
+    // folded in.
+    size_t keep = layers.size();
+    while (keep > 0 && (names[keep - 1].empty() ||
+                        static_cast<std::uint64_t>(layers[keep - 1]->size()) <
+                            static_cast<std::uint64_t>(size_ratio) * entries.size())) {
+        std::vector<CommitGraphEntry> merged = layer_entries(keep - 1);
+        entries.insert(entries.end(), merged.begin(), merged.end());
+        --keep;
+    }
+
+    std::uint32_t base_count = keep == 0 ? 0 : layers[keep - 1]->base_count() + layers[keep - 1]->size();
+    std::string data = CommitGraph::build(entries, base_count,
+        [this, keep](const std::string& hash, std::uint32_t& position, std::uint32_t& generation) {
+            if (!find_below(hash, keep, position)) {
+                return false;
+            }
+            generation = this->generation(position);
+            return true;
+        });
+    if (data.empty()) {
+        return false;
+    }
+
+    std::string name = "graph-" + utils::hex_encode(
+        reinterpret_cast<const unsigned char*>(data.data() + data.size() - CommitGraph::ID_SIZE), CommitGraph::ID_SIZE);
+    if (!utils::write_file_atomic(dir + "/" + name + ".graph", data)) {
+        return false;
+    }
+
+    std::vector<std::string> chain(names.begin(), names.begin() + static_cast<std::ptrdiff_t>(keep));
+    chain.push_back(name);
+    std::string listing;
+    for (const auto& layer : chain) {
+        listing += layer + "\n";
+    }
+
+    if (!lock.commit(listing, chain_path)) {
+        return false;
+    }
+
+    // Layers merged away are no longer referenced
+    std::set<std::string> live(chain.begin(), chain.end());
+    std::vector<std::string> dropped(names.begin() + static_cast<std::ptrdiff_t>(keep), names.end());
+    layers.clear();
+    names.clear();
+    std::error_code ec;
+    for (const auto& old : dropped) {
+        if (old.empty()) {
+            std::filesystem::remove(info_dir + "/commit-graph", ec);
+        } else if (!live.count(old)) {
+            std::filesystem::remove(dir + "/" + old + ".graph", ec);
+        }
+    }
+
+    load();
+    return true;
+}
+
+template class BasicCommitGraph<Sha1Policy>;
+template class BasicCommitGraph<Sha256Policy>;
+template class BasicCommitGraphChain<Sha1Policy>;
+template class BasicCommitGraphChain<Sha256Policy>;
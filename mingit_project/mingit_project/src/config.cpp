@@ -0,0 +1,100 @@
+#include "config.h"
+#include "utils.h"
+#include <cctype>
+#include <charconv>
+#include <limits>
+
+Config::Config(const std::string& path) : path(path) {
+}
+
+bool Config::load() {
+    values.clear();
+    if (path.empty() || !utils::file_exists(path)) {
+        return false;
+    }
+    
+    std::vector<std::string> lines = utils::split(utils::read_file(path), '\n');
+    for (const auto& raw_line : lines) {
+        std::string line = utils::trim(raw_line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        size_t eq_pos = line.find('=');
+        if (eq_pos == std::string::npos) {
+            continue;
+        }
+        
+        std::string key = utils::trim(line.substr(0, eq_pos));
+        std::string value = utils::trim(line.substr(eq_pos + 1));
+        if (!key.empty()) {
+            values[key] = value;
+        }
+    }
+    return true;
+}
+
+bool Config::save() const {
+    std::stringstream ss;
+    for (const auto& [key, value] : values) {
+        ss << key << " = " << value << "\n";
+    }
+    return utils::write_file(path, ss.str());
+}
+
+std::string Config::get(const std::string& key, const std::string& default_value) const {
+    auto it = values.find(key);
+    return it == values.end() ? default_value : it->second;
+}
+
+// Integers accept a k/m/g suffix (powers of 1024), e.g. "512m". Anything
+// else after the number, or a value out of range once scaled, reads as the
+// default.
+std::int64_t Config::get_int(const std::string& key, std::int64_t default_value) const {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.empty()) {
+        return default_value;
+    }
+    
+    const std::string& text = it->second;
+    std::int64_t number = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (error != std::errc() || end == text.data()) {
+        return default_value;
+    }
+    
+    size_t parsed = static_cast<size_t>(end - text.data());
+    if (parsed == text.size()) {
+        return number;
+    }
+    if (parsed + 1 != text.size()) {
+        return default_value;
+    }
+    std::int64_t scale = 0;
+    switch (std::tolower(static_cast<unsigned char>(text[parsed]))) {
+        case 'k': scale = std::int64_t{1} << 10; break;
+        case 'm': scale = std::int64_t{1} << 20; break;
+        case 'g': scale = std::int64_t{1} << 30; break;
+        default: return default_value;
+    }
+    std::int64_t limit = std::numeric_limits<std::int64_t>::max() / scale;
+    if (number > limit || number < -limit) {
+        return default_value;
+    }
+    return number * scale;
+}
+
+bool Config::get_bool(const std::string& key, bool default_value) const {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return default_value;
+    }
+    const std::string& value = it->second;
+    if (value == "true" || value == "yes" || value == "on" || value == "1") {
+        return true;
+    }
+    if (value == "false" || value == "no" || value == "off" || value == "0") {
+        return false;
+    }
+    return default_value;
+}
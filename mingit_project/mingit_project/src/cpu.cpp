@@ -0,0 +1,63 @@
+#include "cpu.h"
+#include "hex.h"
+#include "sha1_multi.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool force_scalar() {
+    const char* value = std::getenv("MINIGIT_FORCE_SCALAR");
+    return value && *value && std::strcmp(value, "0") != 0;
+}
+
+cpu::Features detect() {
+    cpu::Features features;
+    if (force_scalar()) {
+        return features;
+    }
+#ifdef MINIGIT_HAVE_X86_SIMD
+    // Also checks that the OS saves the wider registers
+    __builtin_cpu_init();
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512f = __builtin_cpu_supports("avx512f");
+    features.sha = __builtin_cpu_supports("sha");
+#endif
+    return features;
+}
+
+// Sixteen AVX-512 lanes outrun even the SHA extensions; eight AVX2 lanes
+// only beat plain scalar code
+cpu::Kernels bind(const cpu::Features& features) {
+    cpu::Kernels kernels;
+    kernels.hex_encode = hex::encode_scalar;
+    kernels.hex_decode = hex::decode_scalar;
+#ifdef MINIGIT_HAVE_X86_SIMD
+    if (features.avx2) {
+        kernels.hex_encode = hex::encode_avx2;
+        kernels.hex_decode = hex::decode_avx2;
+    }
+    if (features.avx512f) {
+        kernels.sha1_compress = sha1_multi::compress_avx512;
+        kernels.sha1_lanes = 16;
+    } else if (features.avx2 && !features.sha) {
+        kernels.sha1_compress = sha1_multi::compress_avx2;
+        kernels.sha1_lanes = 8;
+    }
+#else
+    (void)features;
+#endif
+    return kernels;
+}
+
+} // namespace
+
+const cpu::Features& cpu::features() {
+    static const Features features = detect();
+    return features;
+}
+
+const cpu::Kernels& cpu::kernels() {
+    static const Kernels kernels = bind(features());
+    return kernels;
+}
@@ -0,0 +1,304 @@
+#include "delta.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+namespace delta {
+
+namespace {
+
+// Polynomial hash over a block, cheap to roll forward by one byte
+const std::uint32_t HASH_BASE = 0x01000193;
+// Candidates examined per lookup, bounding the cost of repetitive bases
+const int MAX_CHAIN = 64;
+
+std::uint32_t block_hash(const unsigned char* data) {
+    std::uint32_t hash = 0;
+    for (size_t i = 0; i < Index::BLOCK; ++i) {
+        hash = hash * HASH_BASE + data[i];
+    }
+    return hash;
+}
+
+std::uint32_t top_power() {
+    std::uint32_t power = 1;
+    for (size_t i = 1; i < Index::BLOCK; ++i) {
+        power *= HASH_BASE;
+    }
+    return power;
+}
+
+std::uint32_t mix(std::uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+void emit_literals(std::string& out, const std::string& target, size_t from, size_t to) {
+    while (from < to) {
+        size_t n = std::min<size_t>(to - from, 127);
+        out.push_back(static_cast<char>(n));
+        out.append(target, from, n);
+        from += n;
+    }
+}
+
+void emit_copy(std::string& out, std::uint64_t offset, std::uint64_t size) {
+    while (size > 0) {
+        std::uint64_t n = std::min<std::uint64_t>(size, 0xffffff);
+        size_t op_at = out.size();
+        unsigned char op = 0x80;
+        out.push_back(0);
+        for (int i = 0; i < 4; ++i) {
+            unsigned char byte = static_cast<unsigned char>((offset >> (8 * i)) & 0xff);
+            if (byte) {
+                op |= static_cast<unsigned char>(1 << i);
+                out.push_back(static_cast<char>(byte));
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            unsigned char byte = static_cast<unsigned char>((n >> (8 * i)) & 0xff);
+            if (byte) {
+                op |= static_cast<unsigned char>(0x10 << i);
+                out.push_back(static_cast<char>(byte));
+            }
+        }
+        out[op_at] = static_cast<char>(op);
+        offset += n;
+        size -= n;
+    }
+}
+
+} // namespace
+
+bool apply(const std::string& base, const std::string& delta, std::string& out) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(delta.data());
+    const unsigned char* end = p + delta.size();
+    std::uint64_t base_size = 0;
+    std::uint64_t result_size = 0;
+    size_t used = utils::get_varint(p, end, base_size);
+    if (used == 0 || base_size != base.size()) {
+        return false;
+    }
+    p += used;
+    used = utils::get_varint(p, end, result_size);
+    if (used == 0) {
+        return false;
+    }
+    p += used;
+
+    // The declared size comes from the pack and may be damaged, so it only
+    // bounds the reservation; the copies and literals below are checked
+    // against it as they append
+    out.clear();
+    out.reserve(static_cast<size_t>(std::min<std::uint64_t>(result_size, base.size() + delta.size())));
+    while (p < end) {
+        unsigned char op = *p++;
+        if (op & 0x80) {
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (op & (1 << i)) {
+                    if (p == end) {
+                        return false;
+                    }
+                    offset |= static_cast<std::uint64_t>(*p++) << (8 * i);
+                }
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (op & (0x10 << i)) {
+                    if (p == end) {
+                        return false;
+                    }
+                    size |= static_cast<std::uint64_t>(*p++) << (8 * i);
+                }
+            }
+            if (size == 0) {
+                size = 0x10000;
+            }
+            if (offset + size > base.size() || out.size() + size > result_size) {
+                return false;
+            }
+            out.append(base, static_cast<size_t>(offset), static_cast<size_t>(size));
+        } else if (op != 0) {
+            if (static_cast<size_t>(end - p) < op || out.size() + op > result_size) {
+                return false;
+            }
+            out.append(reinterpret_cast<const char*>(p), op);
+            p += op;
+        } else {
+            return false;
+        }
+    }
+    return out.size() == result_size;
+}
+
+bool apply_prefix(const std::string& base, const std::string& delta, size_t length,
+                  std::string& out, size_t& base_needed) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(delta.data());
+    const unsigned char* end = p + delta.size();
+    std::uint64_t base_size = 0;
+    std::uint64_t result_size = 0;
+    base_needed = 0;
+    size_t used = utils::get_varint(p, end, base_size);
+    if (used == 0) {
+        return false;
+    }
+    p += used;
+    used = utils::get_varint(p, end, result_size);
+    if (used == 0) {
+        return false;
+    }
+    p += used;
+
+    // Copies past the end of `base` are filled with zeros while the rest
+    // is walked, to find how much base is needed
+    length = static_cast<size_t>(std::min<std::uint64_t>(length, result_size));
+    out.clear();
+    while (out.size() < length) {
+        if (p == end) {
+            return false;
+        }
+        unsigned char op = *p++;
+        if (op & 0x80) {
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (op & (1 << i)) {
+                    if (p == end) {
+                        return false;
+                    }
+                    offset |= static_cast<std::uint64_t>(*p++) << (8 * i);
+                }
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (op & (0x10 << i)) {
+                    if (p == end) {
+                        return false;
+                    }
+                    size |= static_cast<std::uint64_t>(*p++) << (8 * i);
+                }
+            }
+            if (size == 0) {
+                size = 0x10000;
+            }
+            size_t take = static_cast<size_t>(std::min<std::uint64_t>(size, length - out.size()));
+            if (offset + take > base_size) {
+                return false;
+            }
+            if (offset + take > base.size()) {
+                base_needed = std::max(base_needed, static_cast<size_t>(offset + take));
+                out.append(take, '\0');
+            } else {
+                out.append(base, static_cast<size_t>(offset), take);
+            }
+        } else if (op != 0) {
+            size_t take = std::min<size_t>(op, length - out.size());
+            if (static_cast<size_t>(end - p) < take) {
+                return false;
+            }
+            out.append(reinterpret_cast<const char*>(p), take);
+            p += take;
+        } else {
+            return false;
+        }
+    }
+    return base_needed == 0;
+}
+
+Index::Index(const std::string& base) : base(base) {
+    // Copy offsets are at most four bytes
+    size_t blocks = base.size() <= 0xffffffffULL ? base.size() / BLOCK : 0;
+    size_t buckets = 1;
+    while (buckets < blocks) {
+        buckets <<= 1;
+    }
+    mask = static_cast<std::uint32_t>(buckets - 1);
+    heads.assign(buckets, 0);
+    next.assign(blocks, 0);
+
+    // Inserted back to front so each bucket lists earlier blocks first
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(base.data());
+    for (size_t block = blocks; block-- > 0;) {
+        std::uint32_t bucket = mix(block_hash(data + block * BLOCK)) & mask;
+        next[block] = heads[bucket];
+        heads[bucket] = static_cast<std::uint32_t>(block + 1);
+    }
+}
+
+size_t Index::memory() const {
+    return (heads.size() + next.size()) * sizeof(std::uint32_t);
+}
+
+// Greedy: at each target position, find the longest match starting at an
+// indexed base block, extend it backwards over pending literals, and emit
+// a copy; otherwise advance by one byte, rolling the hash.
+std::string Index::create(const std::string& target, size_t max_size) const {
+    std::string out;
+    utils::put_varint(out, base.size());
+    utils::put_varint(out, target.size());
+    if (next.empty() || target.size() < BLOCK) {
+        emit_literals(out, target, 0, target.size());
+        return out.size() <= max_size ? out : "";
+    }
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(base.data());
+    const unsigned char* dst = reinterpret_cast<const unsigned char*>(target.data());
+    const std::uint32_t power = top_power();
+    size_t literal_start = 0;
+    size_t i = 0;
+    std::uint32_t hash = block_hash(dst);
+
+    while (i + BLOCK <= target.size()) {
+        size_t best_length = 0;
+        size_t best_position = 0;
+        int examined = 0;
+        for (std::uint32_t block = heads[mix(hash) & mask]; block != 0 && examined < MAX_CHAIN;
+             block = next[block - 1], ++examined) {
+            size_t position = (block - 1) * BLOCK;
+            if (std::memcmp(src + position, dst + i, BLOCK) != 0) {
+                continue;
+            }
+            size_t length = BLOCK;
+            while (position + length < base.size() && i + length < target.size() &&
+                   src[position + length] == dst[i + length]) {
+                ++length;
+            }
+            if (length > best_length) {
+                best_length = length;
+                best_position = position;
+            }
+        }
+
+        if (best_length == 0) {
+            if (i + BLOCK < target.size()) {
+                hash = (hash - dst[i] * power) * HASH_BASE + dst[i + BLOCK];
+            }
+            ++i;
+            continue;
+        }
+
+        size_t back = 0;
+        while (back < i - literal_start && back < best_position &&
+               src[best_position - back - 1] == dst[i - back - 1]) {
+            ++back;
+        }
+        emit_literals(out, target, literal_start, i - back);
+        emit_copy(out, best_position - back, best_length + back);
+        if (out.size() > max_size) {
+            return "";
+        }
+
+        i += best_length;
+        literal_start = i;
+        if (i + BLOCK <= target.size()) {
+            hash = block_hash(dst + i);
+        }
+    }
+
+    emit_literals(out, target, literal_start, target.size());
+    return out.size() <= max_size ? out : "";
+}
+
+} // namespace delta
@@ -0,0 +1,114 @@
+#include "dictionary.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dictionary {
+
+namespace {
+
+const size_t KMER = 8;
+const size_t SEGMENT = 64;
+// Candidate segments start this far apart
+const size_t STEP = 16;
+
+std::uint64_t kmer_at(const std::string& data, size_t i) {
+    std::uint64_t value = 0;
+    std::memcpy(&value, data.data() + i, KMER);
+    return value;
+}
+
+struct Candidate {
+    std::uint64_t score;
+    size_t id; // position in the candidate list, the tie break
+    bool operator<(const Candidate& other) const {
+        return score != other.score ? score < other.score : id > other.id;
+    }
+};
+
+} // namespace
+
+// Segment scores only fall as k-mers get covered, so the greedy pick can be
+// lazy: a popped score is recomputed and the segment taken if it still
+// beats the next best, otherwise pushed back with its new score.
+std::string train(const std::vector<std::string>& samples, size_t max_size) {
+    max_size = std::min(max_size, MAX_SIZE);
+
+    // In how many samples each k-mer occurs
+    std::unordered_map<std::uint64_t, std::uint32_t> frequency;
+    for (const auto& sample : samples) {
+        std::unordered_set<std::uint64_t> seen;
+        for (size_t i = 0; i + KMER <= sample.size(); ++i) {
+            std::uint64_t kmer = kmer_at(sample, i);
+            if (seen.insert(kmer).second) {
+                ++frequency[kmer];
+            }
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> segments; // sample, start
+    for (size_t s = 0; s < samples.size(); ++s) {
+        for (size_t start = 0; start + KMER <= samples[s].size(); start += STEP) {
+            segments.emplace_back(s, start);
+        }
+    }
+    auto score = [&](size_t id) {
+        const auto& [s, start] = segments[id];
+        size_t end = std::min(samples[s].size(), start + SEGMENT);
+        std::uint64_t total = 0;
+        for (size_t i = start; i + KMER <= end; ++i) {
+            auto it = frequency.find(kmer_at(samples[s], i));
+            // Substrings found in a single sample are no help to others
+            if (it->second > 1) {
+                total += it->second;
+            }
+        }
+        return total;
+    };
+
+    std::priority_queue<Candidate> queue;
+    for (size_t id = 0; id < segments.size(); ++id) {
+        queue.push({score(id), id});
+    }
+
+    std::vector<size_t> chosen;
+    size_t size = 0;
+    while (!queue.empty() && size < max_size) {
+        Candidate top = queue.top();
+        queue.pop();
+        if (top.score == 0) {
+            break;
+        }
+        std::uint64_t current = score(top.id);
+        if (!queue.empty() && current < queue.top().score) {
+            queue.push({current, top.id});
+            continue;
+        }
+        if (current == 0) {
+            break;
+        }
+
+        const auto& [s, start] = segments[top.id];
+        size_t end = std::min(samples[s].size(), start + SEGMENT);
+        for (size_t i = start; i + KMER <= end; ++i) {
+            frequency[kmer_at(samples[s], i)] = 0;
+        }
+        chosen.push_back(top.id);
+        size += end - start;
+    }
+
+    std::string result;
+    for (size_t i = chosen.size(); i-- > 0;) {
+        const auto& [s, start] = segments[chosen[i]];
+        result.append(samples[s], start, std::min(SEGMENT, samples[s].size() - start));
+    }
+    if (result.size() > max_size) {
+        result.erase(0, result.size() - max_size);
+    }
+    return result;
+}
+
+} // namespace dictionary
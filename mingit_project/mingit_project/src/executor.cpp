@@ -0,0 +1,143 @@
+#include "executor.h"
+#include <algorithm>
+
+namespace {
+
+// Lets post() recognise calls made from one of the pool's own workers
+thread_local const Executor* current_executor = nullptr;
+thread_local unsigned current_index = 0;
+
+unsigned shared_thread_count = 0;
+
+} // namespace
+
+Executor::Executor(unsigned thread_count) {
+    thread_count = std::max(1u, thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (unsigned i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void Executor::post(std::function<void()> job) {
+    unsigned index = current_executor == this
+        ? current_index
+        : next_queue++ % static_cast<unsigned>(queues.size());
+    ++queued;
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back(std::move(job));
+    }
+
+    // Taking the lock orders this against a worker that has just checked
+    // `queued` and is about to sleep
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    wake.notify_one();
+}
+
+bool Executor::pop_local(unsigned index, std::function<void()>& job) {
+    WorkerQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool Executor::steal(unsigned thief, std::function<void()>& job) {
+    unsigned count = static_cast<unsigned>(queues.size());
+    for (unsigned offset = 1; offset < count; ++offset) {
+        WorkerQueue& queue = *queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Executor::worker_loop(unsigned index) {
+    current_executor = this;
+    current_index = index;
+
+    while (true) {
+        std::function<void()> job;
+        if (pop_local(index, job) || steal(index, job)) {
+            --queued;
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool Executor::parallel_for(size_t count, const std::function<void(size_t)>& fn,
+                            std::stop_token stop) {
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+        std::atomic<bool> cancelled{false};
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+
+    // Claim items until none are left; every claimed item counts as
+    // finished, whether it ran or was skipped after a stop request
+    auto run_items = [state, count, &fn, stop] {
+        for (size_t i = state->next++; i < count; i = state->next++) {
+            if (stop.stop_requested()) {
+                state->cancelled = true;
+            } else {
+                fn(i);
+            }
+            if (++state->finished == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(size(), count > 0 ? count - 1 : 0);
+    for (size_t i = 0; i < helpers; ++i) {
+        post(run_items);
+    }
+    run_items();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&] { return state->finished == count; });
+    return !state->cancelled;
+}
+
+void Executor::configure_shared(unsigned thread_count) {
+    shared_thread_count = thread_count;
+}
+
+Executor& Executor::shared() {
+    static Executor executor(shared_thread_count > 0
+                             ? shared_thread_count
+                             : std::thread::hardware_concurrency());
+    return executor;
+}
@@ -0,0 +1,250 @@
+#include "minigit.h"
+#include "utils.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+// Commits whose objects are loaded together, and whose new blobs are
+// loaded in one sorted pass
+const size_t EXPORT_BATCH = 256;
+// Large blobs are copied from the large-object store in pieces this size
+const size_t LARGE_CHUNK = 1 << 20;
+
+struct ExportNode {
+    std::time_t timestamp = 0;
+    std::vector<std::string> parents;
+    std::vector<std::string> children;
+    std::string ref;            // first ref the commit was reached from
+    size_t waiting = 0;         // parents not yet emitted
+    size_t first_parent_of = 0; // children still to emit that diff against it
+};
+
+} // namespace
+
+// Writes a stream that fast_import reads back into identical commits.
+//
+// The walk takes parents and timestamps from the commit-graph where it
+// covers a commit and loads the rest a generation at a time. Commits are
+// then emitted parents first, oldest first among those ready. They are
+// loaded EXPORT_BATCH at a time, and the blobs they introduce are loaded
+// in one sorted pass and written before them, each once, under a mark
+// that later commits refer to. File changes are against the first parent,
+// whose file list is kept only until its last such child is written.
+template <class Policy>
+bool BasicMiniGit<Policy>::fast_export(const std::vector<std::string>& revisions, std::ostream& out) {
+    if (!is_initialized) {
+        utils::report_error("Not a MiniGit repository");
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> tips; // ref, commit
+    for (const auto& revision : revisions) {
+        std::string name = revision == "HEAD" ? current_branch : revision;
+        if (revision == "--all") {
+            for (const auto& [branch_name, branch] : branches) {
+                if (!branch->get_commit_hash().empty()) {
+                    tips.emplace_back("refs/heads/" + branch_name, branch->get_commit_hash());
+                }
+            }
+        } else if (branches.count(name)) {
+            if (!branches[name]->get_commit_hash().empty()) {
+                tips.emplace_back("refs/heads/" + name, branches[name]->get_commit_hash());
+            }
+        } else {
+            utils::report_error("Not a branch: " + revision);
+            return false;
+        }
+    }
+
+    const CommitGraphChain& graph = commit_graph();
+    std::unordered_map<std::string, ExportNode> nodes;
+    std::vector<std::pair<std::string, std::string>> frontier; // commit, ref
+    for (const auto& [ref, tip] : tips) {
+        frontier.emplace_back(tip, ref);
+    }
+    bool ok = true;
+    while (!frontier.empty() && ok) {
+        std::vector<std::string> visited;
+        std::vector<std::string> to_load;
+        for (const auto& [hash, ref] : frontier) {
+            auto [it, inserted] = nodes.try_emplace(hash);
+            if (!inserted) {
+                continue;
+            }
+            ExportNode& node = it->second;
+            node.ref = ref;
+            visited.push_back(hash);
+            std::uint32_t position = 0;
+            if (graph.find(hash, position)) {
+                node.timestamp = graph.timestamp(position);
+                for (std::uint32_t parent : graph.parents(position)) {
+                    node.parents.push_back(graph.hash_at(parent));
+                }
+            } else {
+                to_load.push_back(hash);
+            }
+        }
+        load_objects(to_load, [&](const std::string& hash, const std::string& data) {
+            auto commit = data.empty() ? nullptr : Commit::from_string(data);
+            if (!commit) {
+                utils::report_error("Missing commit " + hash);
+                ok = false;
+                return;
+            }
+            ExportNode& node = nodes.at(hash);
+            node.timestamp = commit->get_timestamp();
+            node.parents = commit->get_parents();
+        });
+
+        // In walk order, not load order, so refs are assigned the same way
+        // whether or not the commit-graph covers a commit
+        frontier.clear();
+        for (const auto& hash : visited) {
+            const ExportNode& node = nodes.at(hash);
+            for (const auto& parent : node.parents) {
+                frontier.emplace_back(parent, node.ref);
+            }
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Topological order: a commit becomes ready once all its parents are out
+    using Ready = std::pair<std::time_t, std::string>;
+    std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready>> ready;
+    for (auto& [hash, node] : nodes) {
+        node.waiting = node.parents.size();
+        for (const auto& parent : node.parents) {
+            nodes.at(parent).children.push_back(hash);
+        }
+        if (!node.parents.empty()) {
+            ++nodes.at(node.parents[0]).first_parent_of;
+        }
+        if (node.waiting == 0) {
+            ready.emplace(node.timestamp, hash);
+        }
+    }
+    std::vector<std::string> order;
+    order.reserve(nodes.size());
+    while (!ready.empty()) {
+        std::string hash = ready.top().second;
+        ready.pop();
+        for (const auto& child : nodes.at(hash).children) {
+            ExportNode& node = nodes.at(child);
+            if (--node.waiting == 0) {
+                ready.emplace(node.timestamp, child);
+            }
+        }
+        order.push_back(std::move(hash));
+    }
+
+    std::unordered_map<std::string, std::uint64_t> marks; // commits and blobs already sent
+    std::unordered_map<std::string, std::map<std::string, std::string>> parent_files;
+    std::uint64_t next_mark = 1;
+    for (size_t begin = 0; begin < order.size(); begin += EXPORT_BATCH) {
+        std::vector<std::string> batch(order.begin() + begin,
+                                       order.begin() + std::min(order.size(), begin + EXPORT_BATCH));
+        std::unordered_map<std::string, std::shared_ptr<Commit>> commits;
+        load_objects(batch, [&commits](const std::string& hash, const std::string& data) {
+            if (auto commit = data.empty() ? nullptr : Commit::from_string(data)) {
+                commits[hash] = commit;
+            }
+        });
+
+        std::vector<std::string> blobs;
+        for (const auto& hash : batch) {
+            if (!commits.count(hash)) {
+                utils::report_error("Missing commit " + hash);
+                return false;
+            }
+            for (const auto& [_, blob] : commits[hash]->get_files()) {
+                if (marks.try_emplace(blob, next_mark).second) {
+                    ++next_mark;
+                    blobs.push_back(blob);
+                }
+            }
+        }
+        load_objects(blobs, [&](const std::string& hash, const std::string& data) {
+            if (!ok) {
+                return;
+            }
+            auto blob = data.empty() ? nullptr : Blob::from_string(data, hash);
+            if (!blob) {
+                utils::report_error("Missing blob " + hash);
+                ok = false;
+                return;
+            }
+            out << "blob\nmark :" << marks[hash] << "\ndata " << blob->size() << '\n';
+            if (!blob->is_large()) {
+                out << blob->get_content();
+            }
+            for (size_t offset = 0; blob->is_large() && offset < blob->size(); offset += LARGE_CHUNK) {
+                std::string chunk = read_large_range(hash, offset, LARGE_CHUNK);
+                if (chunk.empty()) {
+                    utils::report_error("Failed to read large file " + hash);
+                    ok = false;
+                    return;
+                }
+                out << chunk;
+            }
+            out << '\n';
+        });
+        if (!ok) {
+            return false;
+        }
+
+        for (const auto& hash : batch) {
+            const auto& commit = commits[hash];
+            ExportNode& node = nodes.at(hash);
+            if (node.parents.empty()) {
+                out << "reset " << node.ref << '\n';
+            }
+            marks[hash] = next_mark;
+            std::string message = commit->get_message();
+            out << "commit " << node.ref << "\nmark :" << next_mark++ << '\n'
+                << "author " << commit->get_author() << ' ' << commit->get_timestamp() << " +0000\n"
+                << "committer " << commit->get_author() << ' ' << commit->get_timestamp() << " +0000\n"
+                << "data " << message.size() + 1 << '\n' << message << '\n';
+            for (size_t i = 0; i < node.parents.size(); ++i) {
+                out << (i == 0 ? "from :" : "merge :") << marks.at(node.parents[i]) << '\n';
+            }
+
+            std::map<std::string, std::string> files = commit->get_files();
+            static const std::map<std::string, std::string> no_files;
+            const auto& base = node.parents.empty() ? no_files : parent_files.at(node.parents[0]);
+            for (const auto& [path, blob] : files) {
+                auto it = base.find(path);
+                if (it == base.end() || it->second != blob) {
+                    out << "M 100644 :" << marks.at(blob) << ' ' << path << '\n';
+                }
+            }
+            for (const auto& [path, _] : base) {
+                if (!files.count(path)) {
+                    out << "D " << path << '\n';
+                }
+            }
+            out << '\n';
+
+            if (!node.parents.empty() && --nodes.at(node.parents[0]).first_parent_of == 0) {
+                parent_files.erase(node.parents[0]);
+            }
+            if (node.first_parent_of > 0) {
+                parent_files[hash] = std::move(files);
+            }
+        }
+    }
+
+    for (const auto& [ref, tip] : tips) {
+        out << "reset " << ref << "\nfrom :" << marks.at(tip) << "\n\n";
+    }
+    out.flush();
+    return true;
+}
+
+template bool BasicMiniGit<Sha1Policy>::fast_export(const std::vector<std::string>&, std::ostream&);
+template bool BasicMiniGit<Sha256Policy>::fast_export(const std::vector<std::string>&, std::ostream&);
@@ -0,0 +1,547 @@
+#include "minigit.h"
+#include "utils.h"
+#include <algorithm>
+#include <charconv>
+#include <istream>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+// Reads a fast-import stream (a subset of git's format) and writes its
+// objects straight into a pack. Objects already in the repository or
+// earlier in the stream are skipped. Branches are only updated at a
+// `checkpoint` and at the end of the stream, after the pack holding their
+// commits is in place, so readers never see a ref to a missing object.
+template <class Policy>
+class BasicFastImporter {
+private:
+    using PackWriter = BasicPackWriter<Policy>;
+
+    struct BranchState {
+        std::string tip;
+        std::map<std::string, std::string> files; // filename -> blob
+        bool dirty = false;
+    };
+
+    BasicMiniGit<Policy>& git;
+    std::istream& in;
+    std::string line;
+    bool have_line = false;
+    size_t line_number = 0;
+
+    std::unique_ptr<PackWriter> writer;
+    std::unordered_set<std::string> written;   // in the pack being written
+    std::unordered_map<std::string, std::shared_ptr<Commit>> pending_commits; // not yet readable
+    std::unordered_map<std::uint64_t, std::string> marks;
+    std::map<std::string, BranchState> branch_states;
+
+    size_t blob_count = 0;
+    size_t commit_count = 0;
+    size_t duplicate_count = 0;
+    size_t pack_count = 0;
+
+    bool fail(const std::string& message) {
+        utils::print_error("fast-import: line " + std::to_string(line_number) + ": " + message);
+        return false;
+    }
+
+    // Next non-comment line, or the one pushed back by unread()
+    bool next_line() {
+        if (have_line) {
+            have_line = false;
+            return true;
+        }
+        while (std::getline(in, line)) {
+            ++line_number;
+            if (!line.starts_with("#")) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unread() { have_line = true; }
+
+    // "data <count>" followed by exactly that many bytes, or "data <<DELIM"
+    // followed by lines up to one holding DELIM
+    bool read_data(std::string& out) {
+        if (!next_line() || !line.starts_with("data ")) {
+            return fail("expected data");
+        }
+        std::string_view argument = std::string_view(line).substr(5);
+        if (argument.starts_with("<<")) {
+            std::string delimiter(argument.substr(2));
+            out.clear();
+            while (std::getline(in, line)) {
+                ++line_number;
+                if (line == delimiter) {
+                    return true;
+                }
+                out += line;
+                out += '\n';
+            }
+            return fail("unterminated data");
+        }
+
+        size_t length = 0;
+        auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), length);
+        if (error != std::errc() || end != argument.data() + argument.size()) {
+            return fail("bad data length");
+        }
+        out.resize(length);
+        if (!in.read(out.data(), static_cast<std::streamsize>(length))) {
+            return fail("stream ends inside data");
+        }
+        line_number += static_cast<size_t>(std::count(out.begin(), out.end(), '\n'));
+        // An optional LF follows the data
+        if (in.peek() == '\n') {
+            in.get();
+            ++line_number;
+        }
+        return true;
+    }
+
+    bool parse_mark(const std::string& text, std::uint64_t& mark) {
+        if (!text.starts_with(":")) {
+            return false;
+        }
+        auto [end, error] = std::from_chars(text.data() + 1, text.data() + text.size(), mark);
+        return error == std::errc() && end == text.data() + text.size();
+    }
+
+    bool store(const std::string& hash, const std::string& data) {
+        if (written.count(hash) || git.has_object(hash)) {
+            ++duplicate_count;
+            return true;
+        }
+        if (!writer) {
+            writer = std::make_unique<PackWriter>(git.pack_path,
+                                                  static_cast<int>(git.config.get_int("pack.compression", 6)));
+            if (!writer->begin()) {
+                writer.reset();
+                return fail("cannot create pack in " + git.pack_path);
+            }
+        }
+        if (!writer->add(hash, data)) {
+            return fail("cannot write object " + hash);
+        }
+        written.insert(hash);
+        return true;
+    }
+
+    // Content at or above core.bigFileThreshold goes to the large-object
+    // store, with a stub in the pack
+    bool store_blob(const std::string& content, std::string& hash) {
+        auto blob = Blob::create<Policy>(content);
+        hash = blob->get_hash();
+        std::string serialized;
+        if (content.size() >= git.large_file_threshold()) {
+            utils::create_directory(git.large_path);
+            if (!utils::write_file_atomic(git.large_path + "/" + hash, content)) {
+                return fail("cannot store large blob");
+            }
+            serialized = Blob::large_file(hash, content.size())->to_string();
+        } else {
+            serialized = blob->to_string();
+        }
+        ++blob_count;
+        return store(hash, serialized);
+    }
+
+    std::shared_ptr<Commit> find_commit(const std::string& hash) {
+        auto it = pending_commits.find(hash);
+        return it != pending_commits.end() ? it->second : git.load_commit(hash);
+    }
+
+    // Branch name from "refs/heads/<name>" or a bare name
+    static std::string branch_name(const std::string& ref) {
+        return ref.starts_with("refs/heads/") ? ref.substr(11) : ref;
+    }
+
+    // :mark, a commit id, or a branch (as of this point in the stream);
+    // the null id means no commit
+    bool resolve_commit(const std::string& ref, std::string& hash) {
+        std::uint64_t mark = 0;
+        if (parse_mark(ref, mark)) {
+            auto it = marks.find(mark);
+            if (it == marks.end()) {
+                return fail("unknown mark " + ref);
+            }
+            hash = it->second;
+        } else if (git.is_object_id(ref)) {
+            hash = ref.find_first_not_of('0') == std::string::npos ? "" : ref;
+        } else if (auto state = branch_states.find(branch_name(ref)); state != branch_states.end()) {
+            hash = state->second.tip;
+        } else if (auto branch = git.branches.find(branch_name(ref)); branch != git.branches.end()) {
+            hash = branch->second->get_commit_hash();
+        } else {
+            return fail("unknown commit " + ref);
+        }
+        return true;
+    }
+
+    // A branch first touched in the stream starts where the repository has it
+    BranchState& state_of(const std::string& name) {
+        auto [it, inserted] = branch_states.try_emplace(name);
+        if (inserted) {
+            auto branch = git.branches.find(name);
+            if (branch != git.branches.end() && !branch->second->get_commit_hash().empty()) {
+                reset_to(it->second, branch->second->get_commit_hash());
+            }
+        }
+        return it->second;
+    }
+
+    bool reset_to(BranchState& state, const std::string& hash) {
+        state.tip = hash;
+        state.files.clear();
+        if (hash.empty()) {
+            return true;
+        }
+        auto commit = find_commit(hash);
+        if (!commit) {
+            return fail("cannot read commit " + hash);
+        }
+        state.files = commit->get_files();
+        return true;
+    }
+
+    bool parse_blob() {
+        std::uint64_t mark = 0;
+        bool has_mark = false;
+        if (next_line()) {
+            has_mark = line.starts_with("mark ") && parse_mark(line.substr(5), mark);
+            if (!has_mark) {
+                unread();
+            }
+        }
+        std::string content;
+        if (!read_data(content)) {
+            return false;
+        }
+
+        std::string hash;
+        if (!store_blob(content, hash)) {
+            return false;
+        }
+        if (has_mark) {
+            marks[mark] = hash;
+        }
+        return true;
+    }
+
+    // Paths are stored space-separated in commits, so they cannot hold
+    // spaces or newlines. A C-style quoted path is unquoted first; git
+    // writes bytes outside ASCII as three octal digits ("\303\251" for
+    // "é"). Unknown escapes reject the stream.
+    bool parse_path(std::string text, std::string& path) {
+        if (text.starts_with("\"")) {
+            path.clear();
+            size_t i = 1;
+            for (; i < text.size() && text[i] != '"'; ++i) {
+                if (text[i] != '\\') {
+                    path += text[i];
+                    continue;
+                }
+                if (++i == text.size()) {
+                    break;
+                }
+                char c = text[i];
+                if (c >= '0' && c <= '3') {
+                    if (i + 2 >= text.size() || text[i + 1] < '0' || text[i + 1] > '7' ||
+                        text[i + 2] < '0' || text[i + 2] > '7') {
+                        return fail("bad octal escape in path " + text);
+                    }
+                    path += static_cast<char>((c - '0') << 6 | (text[i + 1] - '0') << 3 | (text[i + 2] - '0'));
+                    i += 2;
+                    continue;
+                }
+                switch (c) {
+                case 'a': path += '\a'; break;
+                case 'b': path += '\b'; break;
+                case 'f': path += '\f'; break;
+                case 'n': path += '\n'; break;
+                case 'r': path += '\r'; break;
+                case 't': path += '\t'; break;
+                case 'v': path += '\v'; break;
+                case '\\':
+                case '"': path += c; break;
+                default: return fail("bad escape in path " + text);
+                }
+            }
+            if (i >= text.size()) {
+                return fail("unterminated path " + text);
+            }
+        } else {
+            path = std::move(text);
+        }
+        if (path.empty() || path.find_first_of(" \n") != std::string::npos) {
+            return fail("unsupported path '" + path + "'");
+        }
+        return true;
+    }
+
+    bool parse_commit(const std::string& ref) {
+        std::string name = branch_name(ref);
+        std::uint64_t mark = 0;
+        bool has_mark = false;
+        std::string author;
+        std::time_t timestamp = std::time(nullptr);
+
+        // "<name> <email> <time> <tz>": the author is everything before the
+        // time; the committer's time wins as it orders history
+        auto parse_person = [&](const std::string& text, bool use_time) {
+            size_t tz = text.rfind(' ');
+            size_t time = tz == std::string::npos || tz == 0 ? std::string::npos : text.rfind(' ', tz - 1);
+            if (time == std::string::npos) {
+                return false;
+            }
+            if (author.empty() || !use_time) {
+                author = text.substr(0, time);
+            }
+            if (use_time) {
+                timestamp = static_cast<std::time_t>(std::atoll(text.c_str() + time + 1));
+            }
+            return true;
+        };
+
+        while (next_line()) {
+            if (line.starts_with("mark ")) {
+                has_mark = parse_mark(line.substr(5), mark);
+                if (!has_mark) {
+                    return fail("bad mark");
+                }
+            } else if (line.starts_with("author ")) {
+                if (!parse_person(line.substr(7), false)) {
+                    return fail("bad author");
+                }
+            } else if (line.starts_with("committer ")) {
+                if (!parse_person(line.substr(10), true)) {
+                    return fail("bad committer");
+                }
+            } else if (line.starts_with("original-oid ")) {
+                continue;
+            } else {
+                unread();
+                break;
+            }
+        }
+
+        // Commit messages are stored on one line
+        std::string message;
+        if (!read_data(message)) {
+            return false;
+        }
+        while (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+        std::replace(message.begin(), message.end(), '\n', ' ');
+
+        BranchState& state = state_of(name);
+        std::vector<std::string> parents;
+        if (!state.tip.empty()) {
+            parents.push_back(state.tip);
+        }
+        while (next_line()) {
+            std::string hash;
+            if (line.starts_with("from ")) {
+                if (!resolve_commit(line.substr(5), hash) || !reset_to(state, hash)) {
+                    return false;
+                }
+                parents.clear();
+                if (!hash.empty()) {
+                    parents.push_back(hash);
+                }
+            } else if (line.starts_with("merge ")) {
+                if (!resolve_commit(line.substr(6), hash)) {
+                    return false;
+                }
+                if (!hash.empty()) {
+                    parents.push_back(hash);
+                }
+            } else if (line.starts_with("M ")) {
+                // M <mode> <dataref> <path>; modes are not recorded
+                size_t mode_end = line.find(' ', 2);
+                size_t ref_end = mode_end == std::string::npos ? mode_end : line.find(' ', mode_end + 1);
+                if (ref_end == std::string::npos) {
+                    return fail("bad file modification");
+                }
+                std::string data_ref = line.substr(mode_end + 1, ref_end - mode_end - 1);
+                std::string path;
+                if (!parse_path(line.substr(ref_end + 1), path)) {
+                    return false;
+                }
+                if (data_ref == "inline") {
+                    std::string content;
+                    if (!read_data(content)) {
+                        return false;
+                    }
+                    if (!store_blob(content, hash)) {
+                        return false;
+                    }
+                } else if (std::uint64_t blob_mark = 0; parse_mark(data_ref, blob_mark)) {
+                    auto it = marks.find(blob_mark);
+                    if (it == marks.end()) {
+                        return fail("unknown mark " + data_ref);
+                    }
+                    hash = it->second;
+                } else if (git.is_object_id(data_ref) && (written.count(data_ref) || git.has_object(data_ref))) {
+                    hash = data_ref;
+                } else {
+                    return fail("unknown blob " + data_ref);
+                }
+                state.files[path] = hash;
+            } else if (line.starts_with("D ")) {
+                std::string path;
+                if (!parse_path(line.substr(2), path)) {
+                    return false;
+                }
+                state.files.erase(path);
+            } else if (line == "deleteall") {
+                state.files.clear();
+            } else {
+                if (!line.empty()) {
+                    unread();
+                }
+                break;
+            }
+        }
+
+        auto commit = std::make_shared<Commit>(message, author.empty() ? "user" : author);
+        commit->set_timestamp(timestamp);
+        for (const auto& parent : parents) {
+            commit->add_parent(parent);
+        }
+        for (const auto& [path, blob] : state.files) {
+            commit->add_file(path, blob);
+        }
+        commit->set_hash(commit->compute_hash<Policy>());
+        if (!store(commit->get_hash(), commit->to_string())) {
+            return false;
+        }
+        pending_commits[commit->get_hash()] = commit;
+        if (has_mark) {
+            marks[mark] = commit->get_hash();
+        }
+        state.tip = commit->get_hash();
+        state.dirty = true;
+        ++commit_count;
+        return true;
+    }
+
+    bool parse_reset(const std::string& ref) {
+        BranchState& state = branch_states[branch_name(ref)];
+        state.tip.clear();
+        state.files.clear();
+        state.dirty = true;
+        if (next_line()) {
+            std::string hash;
+            if (!line.starts_with("from ")) {
+                if (!line.empty()) {
+                    unread();
+                }
+                return true;
+            }
+            if (!resolve_commit(line.substr(5), hash) || !reset_to(state, hash)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    BasicFastImporter(BasicMiniGit<Policy>& git, std::istream& in) : git(git), in(in) {}
+
+    // Makes the objects so far readable and points the branches at them
+    bool checkpoint() {
+        if (writer) {
+            std::string name = writer->finish();
+            writer.reset();
+            if (name.empty()) {
+                return fail("cannot finish pack");
+            }
+            ++pack_count;
+            git.packs().load();
+            if (!git.packs().write_multi_pack_index()) {
+                utils::print_warning("Failed to write multi-pack-index");
+            }
+        }
+        written.clear();
+        pending_commits.clear();
+
+        for (auto& [name, state] : branch_states) {
+            if (!state.dirty || state.tip.empty()) {
+                continue;
+            }
+            auto& branch = git.branches[name];
+            if (!branch) {
+                branch = std::make_shared<Branch>(name);
+            }
+            branch->set_commit_hash(state.tip);
+            git.save_branch(branch);
+            if (name == git.current_branch) {
+                git.save_head(state.tip);
+            }
+            state.dirty = false;
+        }
+        return true;
+    }
+
+    bool run() {
+        while (next_line()) {
+            bool ok = true;
+            if (line == "blob") {
+                ok = parse_blob();
+            } else if (line.starts_with("commit ")) {
+                ok = parse_commit(line.substr(7));
+            } else if (line.starts_with("reset ")) {
+                ok = parse_reset(line.substr(6));
+            } else if (line == "checkpoint") {
+                ok = checkpoint();
+            } else if (line.starts_with("progress ")) {
+                std::cout << line << std::endl;
+            } else if (line == "done") {
+                break;
+            } else if (line.starts_with("feature ") || line.starts_with("option ") || line.empty()) {
+                continue;
+            } else {
+                ok = fail("unsupported command '" + line + "'");
+            }
+            if (!ok) {
+                // Keep what was written; refs stay at the last checkpoint
+                if (writer) {
+                    writer->finish();
+                }
+                return false;
+            }
+        }
+        return checkpoint();
+    }
+
+    std::string summary() const {
+        return "Imported " + std::to_string(blob_count) + " blobs and " + std::to_string(commit_count) +
+               " commits (" + std::to_string(duplicate_count) + " duplicates) into " +
+               std::to_string(pack_count) + " packs";
+    }
+};
+
+template <class Policy>
+bool BasicMiniGit<Policy>::fast_import(std::istream& in) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+
+    BasicFastImporter<Policy> importer(*this, in);
+    if (!importer.run()) {
+        return false;
+    }
+    if (config.get_bool("commitGraph.writeOnCommit", true)) {
+        update_commit_graph();
+    }
+    utils::print_success(importer.summary());
+    return true;
+}
+
+template bool BasicMiniGit<Sha1Policy>::fast_import(std::istream&);
+template bool BasicMiniGit<Sha256Policy>::fast_import(std::istream&);
@@ -0,0 +1,161 @@
+#include "minigit.h"
+#include "executor.h"
+#include "utils.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+// Objects loaded per load_objects call
+const size_t FSCK_BATCH = 1024;
+// Hash inputs handed to one hash_all call on a pool thread
+const size_t HASH_GROUP = 64;
+
+} // namespace
+
+// Every object, loose or packed, must hash to its id, and every object a
+// commit or a reference names must exist and have the expected type.
+// Objects are loaded in batches, packed ones in pack order, and each batch
+// is hashed in groups spread over the executor (for SHA-1, every group
+// through sha1_multi at once).
+template <class Policy>
+bool BasicMiniGit<Policy>::fsck() {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+
+    std::vector<std::string> ids = list_loose_objects();
+    std::unordered_set<std::string> known(ids.begin(), ids.end());
+    for (const auto& pack : packs().get_packs()) {
+        const PackIndex& index = pack->get_index();
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> order;
+        for (std::uint32_t i = 0; i < index.size(); ++i) {
+            order.emplace_back(index.offset_at(i), i);
+        }
+        std::sort(order.begin(), order.end());
+        for (const auto& [_, i] : order) {
+            std::string id = utils::hex_encode(index.id_at(i), Policy::DIGEST_SIZE);
+            if (known.insert(id).second) {
+                ids.push_back(std::move(id));
+            }
+        }
+    }
+
+    // Commits a reference or parent line names, and blobs a file line names
+    std::unordered_set<std::string> referenced_commits;
+    std::unordered_set<std::string> referenced_blobs;
+    for (const auto& tip : reference_tips()) {
+        referenced_commits.insert(tip);
+    }
+    // Ids of each type, to check the references against
+    std::unordered_set<std::string> commits;
+    std::unordered_set<std::string> blobs;
+    size_t corrupt = 0;
+    Executor& executor = Executor::shared();
+    for (size_t begin = 0; begin < ids.size(); begin += FSCK_BATCH) {
+        std::vector<std::string> batch(ids.begin() + begin,
+                                       ids.begin() + std::min(ids.size(), begin + FSCK_BATCH));
+        // What each object's id is the hash of: "<type> <length>\0" and then
+        // a commit's body after its "commit <id>" line, or a blob's content
+        // after its header
+        std::vector<std::string> names;
+        std::vector<std::string> objects;
+        std::vector<std::string_view> inputs;
+        load_objects(batch, [&](const std::string& hash, const std::string& data) {
+            size_t header_end = data.find('\n');
+            ObjectType type = object_type_of(data);
+            // A blob header whose length disagrees with the content would
+            // still hash to the id, since the id covers the content's length
+            if ((type == ObjectType::Blob || type == ObjectType::Large) && !Blob::from_string(data, hash)) {
+                type = ObjectType::None;
+            }
+            std::shared_ptr<Commit> commit = type == ObjectType::Commit ? Commit::from_string(data) : nullptr;
+            std::string_view payload;
+            if (commit && header_end != std::string::npos) {
+                for (const auto& parent : commit->get_parents()) {
+                    referenced_commits.insert(parent);
+                }
+                for (const auto& [_, blob] : commit->get_files()) {
+                    referenced_blobs.insert(blob);
+                }
+                commits.insert(hash);
+                payload = std::string_view(data).substr(header_end + 1);
+                names.push_back(hash);
+                objects.push_back(utils::object_header("commit", payload.size()));
+            } else if (type == ObjectType::Large) {
+                blobs.insert(hash);
+                std::string path = large_path + "/" + hash;
+                if (utils::hash_file(Policy::algorithm(), path, utils::object_header("blob", utils::file_size(path))) != hash) {
+                    utils::print_error("Large file " + hash + " is missing or corrupt");
+                    ++corrupt;
+                }
+                return;
+            } else if (type == ObjectType::Blob && header_end != std::string::npos) {
+                blobs.insert(hash);
+                // Blobs from before content addressing carry their (SHA-1) id
+                // in the header and were hashed differently; they are not
+                // checked
+                if (header_end - 5 == LEGACY_BLOB_ID_HEX_SIZE) {
+                    return;
+                }
+                payload = std::string_view(data).substr(header_end + 1);
+                names.push_back(hash);
+                objects.push_back(utils::object_header("blob", payload.size()));
+            } else {
+                utils::print_error("Cannot read object " + hash);
+                ++corrupt;
+                return;
+            }
+            objects.back().append(payload);
+        });
+        for (const auto& object : objects) {
+            inputs.push_back(object);
+        }
+
+        std::vector<std::string> digests(inputs.size());
+        size_t groups = (inputs.size() + HASH_GROUP - 1) / HASH_GROUP;
+        executor.parallel_for(groups, [&](size_t group) {
+            size_t first = group * HASH_GROUP;
+            size_t last = std::min(inputs.size(), first + HASH_GROUP);
+            std::vector<std::string> hashes =
+                hash_all(std::vector<std::string_view>(inputs.begin() + first, inputs.begin() + last));
+            std::move(hashes.begin(), hashes.end(), digests.begin() + first);
+        });
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (digests[i] != names[i]) {
+                utils::print_error("Object " + names[i] + " hashes to " + digests[i]);
+                ++corrupt;
+            }
+        }
+    }
+
+    // An object that could not be read at all was counted above; one that
+    // was read must have the type its reference expects
+    size_t missing = 0;
+    auto check = [&](const std::unordered_set<std::string>& referenced,
+                     const std::unordered_set<std::string>& of_type, const std::string& type) {
+        for (const auto& id : referenced) {
+            if (!known.count(id)) {
+                utils::print_error("Missing object " + id);
+                ++missing;
+            } else if (!of_type.count(id) && (commits.count(id) || blobs.count(id))) {
+                utils::print_error("Object " + id + " is not a " + type);
+                ++corrupt;
+            }
+        }
+    };
+    check(referenced_commits, commits, "commit");
+    check(referenced_blobs, blobs, "blob");
+
+    if (corrupt > 0 || missing > 0) {
+        utils::print_error("Checked " + std::to_string(ids.size()) + " objects: " + std::to_string(corrupt) +
+                           " corrupt, " + std::to_string(missing) + " missing");
+        return false;
+    }
+    utils::print_success("Checked " + std::to_string(ids.size()) + " objects");
+    return true;
+}
+
+template bool BasicMiniGit<Sha1Policy>::fsck();
+template bool BasicMiniGit<Sha256Policy>::fsck();
@@ -0,0 +1,54 @@
+#include "hex.h"
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr char DIGITS[] = "0123456789abcdef";
+
+// Both digits of every byte value
+constexpr std::array<char, 512> ENCODE = [] {
+    std::array<char, 512> table{};
+    for (size_t i = 0; i < 256; ++i) {
+        table[2 * i] = DIGITS[i >> 4];
+        table[2 * i + 1] = DIGITS[i & 15];
+    }
+    return table;
+}();
+
+// Value of every character as a digit, -1 if it is not one
+constexpr std::array<std::int8_t, 256> DECODE = [] {
+    std::array<std::int8_t, 256> table{};
+    for (auto& value : table) {
+        value = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+        table['0' + i] = static_cast<std::int8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        table['a' + i] = static_cast<std::int8_t>(10 + i);
+        table['A' + i] = static_cast<std::int8_t>(10 + i);
+    }
+    return table;
+}();
+
+} // namespace
+
+void hex::encode_scalar(const unsigned char* data, size_t length, char* out) {
+    for (size_t i = 0; i < length; ++i) {
+        out[2 * i] = ENCODE[2 * data[i]];
+        out[2 * i + 1] = ENCODE[2 * data[i] + 1];
+    }
+}
+
+bool hex::decode_scalar(const char* hex, size_t length, unsigned char* out) {
+    for (size_t i = 0; i < length; ++i) {
+        int high = DECODE[static_cast<unsigned char>(hex[2 * i])];
+        int low = DECODE[static_cast<unsigned char>(hex[2 * i + 1])];
+        if ((high | low) < 0) {
+            return false;
+        }
+        out[i] = static_cast<unsigned char>(high << 4 | low);
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+// Built with -mavx2; only called once the CPU is known to support it
+#include "hex.h"
+#include <immintrin.h>
+
+// 16 bytes become 32 digits: the nibbles are interleaved high first and
+// each looked up in a 16-entry digit table with one shuffle
+void hex::encode_avx2(const unsigned char* data, size_t length, char* out) {
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+                                            'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a',
+                                            'b', 'c', 'd', 'e', 'f');
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble);
+        __m128i low = _mm_and_si128(bytes, low_nibble);
+        __m256i nibbles = _mm256_set_m128i(_mm_unpackhi_epi8(high, low), _mm_unpacklo_epi8(high, low));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_shuffle_epi8(digits, nibbles));
+    }
+    encode_scalar(data + i, length - i, out + 2 * i);
+}
+
+// 32 digits become 16 bytes. Digits and letters (either case, via 0x20)
+// are told apart by range checks; any character in neither range fails
+// the whole call. Pairs of nibbles are joined with one multiply-add.
+bool hex::decode_avx2(const char* hex, size_t length, unsigned char* out) {
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + 2 * i));
+        __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(digit, minus_one),
+                                            _mm256_cmpgt_epi8(_mm256_set1_epi8(10), digit));
+        __m256i is_letter = _mm256_and_si256(_mm256_cmpgt_epi8(letter, minus_one),
+                                             _mm256_cmpgt_epi8(_mm256_set1_epi8(6), letter));
+        if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != -1) {
+            return false;
+        }
+        __m256i nibbles = _mm256_blendv_epi8(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), digit, is_digit);
+        __m256i words = _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+    }
+    return decode_scalar(hex + 2 * i, length - i, out + i);
+}
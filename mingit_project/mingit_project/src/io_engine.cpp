@@ -0,0 +1,464 @@
+#include "io_engine.h"
+#include "executor.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef MINIGIT_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#endif
+
+namespace {
+
+// Fallback engine: blocking calls spread over the shared thread pool.
+class ThreadIoEngine : public IoEngine {
+public:
+    void read_files(std::vector<IoRequest>& requests) override {
+        Executor::shared().parallel_for(requests.size(), [&requests](size_t i) {
+            IoRequest& request = requests[i];
+            request.ok = utils::file_exists(request.path);
+            request.data = request.ok ? utils::read_file(request.path) : "";
+        });
+    }
+
+    void write_files(std::vector<IoRequest>& requests) override {
+        Executor::shared().parallel_for(requests.size(), [&requests](size_t i) {
+            IoRequest& request = requests[i];
+            request.ok = utils::write_file(request.path, request.data);
+        });
+    }
+
+    std::string name() const override { return "threads"; }
+};
+
+#ifdef MINIGIT_HAVE_IO_URING
+
+// Minimal io_uring wrapper over the raw syscalls: one submission ring, one
+// completion ring, no SQ polling.
+class Ring {
+private:
+    int ring_fd = -1;
+    void* sq_ptr = nullptr;
+    void* cq_ptr = nullptr;
+    size_t sq_size = 0;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending_submit = 0;
+
+public:
+    ~Ring() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+        if (sq_ptr) munmap(sq_ptr, sq_size);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd < 0) {
+            return false;
+        }
+
+        // OPENAT, STATX and CLOSE arrived in 5.6, together with RW_CUR_POS
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            return false;
+        }
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+
+        sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            sq_ptr = nullptr;
+            return false;
+        }
+
+        if (single_mmap) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                cq_ptr = nullptr;
+                return false;
+            }
+        }
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd, IORING_OFF_SQES);
+        if (sqes_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+        char* sq = static_cast<char*>(sq_ptr);
+        char* cq = static_cast<char*>(cq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Callers never queue more than the ring size between submits.
+    io_uring_sqe* next_sqe() {
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++pending_submit;
+        return sqe;
+    }
+
+    bool submit_and_wait(unsigned wait_nr) {
+        int ret;
+        do {
+            ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, pending_submit, wait_nr,
+                                           IORING_ENTER_GETEVENTS, nullptr, 0));
+        } while (ret < 0 && errno == EINTR);
+        if (ret < 0) {
+            return false;
+        }
+        pending_submit -= static_cast<unsigned>(ret);
+        return true;
+    }
+
+    // Takes back the SQEs queued since the last submit. A failed enter
+    // consumes none, so the kernel has not seen them. Returns their count.
+    unsigned discard_unsubmitted() {
+        unsigned count = pending_submit;
+        __atomic_store_n(sq_tail, *sq_tail - count, __ATOMIC_RELEASE);
+        pending_submit = 0;
+        return count;
+    }
+
+    // Waits for completions without submitting anything. EBUSY means the
+    // completion ring is full, which the caller's reap clears.
+    bool wait(unsigned wait_nr) {
+        int ret;
+        do {
+            ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, 0, wait_nr,
+                                           IORING_ENTER_GETEVENTS, nullptr, 0));
+        } while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+        return ret >= 0 || errno == EBUSY;
+    }
+
+    template <typename Fn>
+    void reap(Fn fn) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & *cq_mask];
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            fn(cqe);
+            tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+};
+
+// Each file runs through open (+ statx for reads) -> read/write -> close.
+// Every completion immediately queues that file's next step, so up to
+// queue_depth operations across different files stay in flight.
+class UringIoEngine : public IoEngine {
+private:
+    enum Op : std::uint64_t { OP_OPEN = 0, OP_STATX = 1, OP_DATA = 2, OP_CLOSE = 3 };
+
+    struct FileState {
+        int fd = -1;
+        int waiting = 0;        // outstanding open/statx completions
+        std::uint64_t size = 0;
+        std::uint64_t done = 0;
+        bool failed = false;
+        struct statx stx;
+    };
+
+    Ring ring;
+    unsigned depth;
+
+    static std::uint64_t tag(size_t index, Op op) { return (static_cast<std::uint64_t>(index) << 2) | op; }
+
+    void queue_open(size_t index, const std::string& path, int flags) {
+        io_uring_sqe* sqe = ring.next_sqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(path.c_str());
+        sqe->len = 0644;
+        sqe->open_flags = static_cast<std::uint32_t>(flags | O_CLOEXEC);
+        sqe->user_data = tag(index, OP_OPEN);
+    }
+
+    void queue_statx(size_t index, const std::string& path, FileState& state) {
+        io_uring_sqe* sqe = ring.next_sqe();
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(path.c_str());
+        sqe->len = STATX_SIZE;
+        sqe->off = reinterpret_cast<std::uint64_t>(&state.stx);
+        sqe->user_data = tag(index, OP_STATX);
+    }
+
+    void queue_data(size_t index, std::uint8_t opcode, FileState& state, std::string& data) {
+        io_uring_sqe* sqe = ring.next_sqe();
+        sqe->opcode = opcode;
+        sqe->fd = state.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(data.data() + state.done);
+        sqe->len = static_cast<std::uint32_t>(std::min<std::uint64_t>(state.size - state.done, 1u << 30));
+        sqe->off = state.done;
+        sqe->user_data = tag(index, OP_DATA);
+    }
+
+    void queue_close(size_t index, FileState& state) {
+        io_uring_sqe* sqe = ring.next_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = state.fd;
+        sqe->user_data = tag(index, OP_CLOSE);
+    }
+
+    // Drives all requests to completion. start() queues the first step of a
+    // request (returning how many SQEs it used) and advance() handles one
+    // completion, returning true once the request is finished.
+    //
+    // If the ring fails, SQEs already submitted still point at `states` and
+    // the request buffers, and may be opening files. Those are waited for,
+    // anything they opened is closed, and only then does the caller fall
+    // back to blocking I/O.
+    template <typename Start, typename Advance>
+    bool drive(std::vector<FileState>& states, unsigned per_start, Start start, Advance advance) {
+        size_t count = states.size();
+        size_t next = 0;
+        size_t finished = 0;
+        unsigned in_flight = 0;
+
+        while (finished < count) {
+            while (next < count && in_flight + per_start <= depth) {
+                in_flight += start(next++);
+            }
+            if (!ring.submit_and_wait(1)) {
+                in_flight -= ring.discard_unsubmitted();
+                abandon(states, in_flight);
+                return false;
+            }
+            ring.reap([&](const io_uring_cqe& cqe) {
+                --in_flight;
+                size_t index = static_cast<size_t>(cqe.user_data >> 2);
+                Op op = static_cast<Op>(cqe.user_data & 3);
+                unsigned queued = 0;
+                if (advance(index, op, cqe.res, queued)) {
+                    ++finished;
+                }
+                if (op == OP_CLOSE) {
+                    states[index].fd = -1;
+                }
+                in_flight += queued;
+            });
+        }
+        return true;
+    }
+
+    // Collects the `in_flight` outstanding completions without queueing
+    // follow-ups, then closes every file still open. Memory the kernel may
+    // still write to cannot be released, so a ring that cannot even be
+    // waited on ends the process.
+    void abandon(std::vector<FileState>& states, unsigned in_flight) {
+        while (in_flight > 0) {
+            if (!ring.wait(1)) {
+                utils::print_error("io_uring failed with operations in flight");
+                std::abort();
+            }
+            ring.reap([&](const io_uring_cqe& cqe) {
+                --in_flight;
+                FileState& state = states[static_cast<size_t>(cqe.user_data >> 2)];
+                Op op = static_cast<Op>(cqe.user_data & 3);
+                if (op == OP_OPEN && cqe.res >= 0) {
+                    state.fd = cqe.res;
+                } else if (op == OP_CLOSE) {
+                    state.fd = -1;
+                }
+            });
+        }
+        for (FileState& state : states) {
+            if (state.fd >= 0) {
+                close(state.fd);
+                state.fd = -1;
+            }
+        }
+    }
+
+public:
+    explicit UringIoEngine(unsigned depth) : depth(std::max(2u, depth)) {}
+
+    bool init() { return ring.init(depth); }
+
+    void read_files(std::vector<IoRequest>& requests) override {
+        std::vector<FileState> states(requests.size());
+
+        auto start = [&](size_t i) -> unsigned {
+            states[i].waiting = 2;
+            queue_open(i, requests[i].path, O_RDONLY);
+            queue_statx(i, requests[i].path, states[i]);
+            return 2;
+        };
+
+        auto advance = [&](size_t i, Op op, int res, unsigned& queued) -> bool {
+            FileState& state = states[i];
+            IoRequest& request = requests[i];
+            switch (op) {
+                case OP_OPEN:
+                case OP_STATX:
+                    if (res < 0) {
+                        state.failed = true;
+                    } else if (op == OP_OPEN) {
+                        state.fd = res;
+                    } else {
+                        state.size = state.stx.stx_size;
+                    }
+                    if (--state.waiting > 0) {
+                        return false;
+                    }
+                    if (state.fd < 0) {
+                        return true;
+                    }
+                    if (state.failed || state.size == 0) {
+                        queue_close(i, state);
+                    } else {
+                        request.data.resize(state.size);
+                        queue_data(i, IORING_OP_READ, state, request.data);
+                    }
+                    queued = 1;
+                    return false;
+                case OP_DATA:
+                    if (res < 0) {
+                        state.failed = true;
+                    } else if (res == 0) {
+                        // File shrank since statx
+                        request.data.resize(state.done);
+                        state.size = state.done;
+                    } else {
+                        state.done += static_cast<std::uint64_t>(res);
+                    }
+                    if (!state.failed && state.done < state.size) {
+                        queue_data(i, IORING_OP_READ, state, request.data);
+                    } else {
+                        queue_close(i, state);
+                    }
+                    queued = 1;
+                    return false;
+                case OP_CLOSE:
+                    request.ok = !state.failed;
+                    if (!request.ok) {
+                        request.data.clear();
+                    }
+                    return true;
+            }
+            return true;
+        };
+
+        if (!drive(states, 2, start, advance)) {
+            ThreadIoEngine().read_files(requests);
+        }
+    }
+
+    void write_files(std::vector<IoRequest>& requests) override {
+        std::vector<FileState> states(requests.size());
+
+        auto start = [&](size_t i) -> unsigned {
+            states[i].size = requests[i].data.size();
+            queue_open(i, requests[i].path, O_WRONLY | O_CREAT | O_TRUNC);
+            return 1;
+        };
+
+        auto advance = [&](size_t i, Op op, int res, unsigned& queued) -> bool {
+            FileState& state = states[i];
+            IoRequest& request = requests[i];
+            switch (op) {
+                case OP_OPEN:
+                    if (res < 0) {
+                        return true;
+                    }
+                    state.fd = res;
+                    if (state.size == 0) {
+                        queue_close(i, state);
+                    } else {
+                        queue_data(i, IORING_OP_WRITE, state, request.data);
+                    }
+                    queued = 1;
+                    return false;
+                case OP_DATA:
+                    if (res <= 0) {
+                        state.failed = true;
+                    } else {
+                        state.done += static_cast<std::uint64_t>(res);
+                    }
+                    if (!state.failed && state.done < state.size) {
+                        queue_data(i, IORING_OP_WRITE, state, request.data);
+                    } else {
+                        queue_close(i, state);
+                    }
+                    queued = 1;
+                    return false;
+                case OP_CLOSE:
+                    request.ok = !state.failed && res >= 0;
+                    return true;
+                case OP_STATX:
+                    break;
+            }
+            return true;
+        };
+
+        if (!drive(states, 1, start, advance)) {
+            ThreadIoEngine().write_files(requests);
+        }
+    }
+
+    std::string name() const override { return "io_uring"; }
+};
+
+#endif // MINIGIT_HAVE_IO_URING
+
+} // namespace
+
+std::unique_ptr<IoEngine> IoEngine::create(const std::string& kind, unsigned queue_depth) {
+#ifdef MINIGIT_HAVE_IO_URING
+    if (kind != "threads") {
+        auto engine = std::make_unique<UringIoEngine>(queue_depth);
+        if (engine->init()) {
+            return engine;
+        }
+        if (kind == "io_uring") {
+            utils::print_warning("io_uring unavailable, using thread pool for I/O");
+        }
+    }
+#else
+    (void)kind;
+#endif
+    (void)queue_depth;
+    return std::make_unique<ThreadIoEngine>();
+}
@@ -1,14 +1,17 @@
 #include "minigit.h"
 #include "utils.h"
+#include "cpu.h"
+#include <charconv>
 #include <iostream>
 #include <string>
+#include <cstdlib>
 
 void print_usage() {
     std::cout << "MiniGit - A Custom Version Control System\n";
     std::cout << "Usage: minigit <command> [options]\n\n";
     std::cout << "Commands:\n";
-    std::cout << "  init                    Initialize a new MiniGit repository\n";
-    std::cout << "  add <file>              Add file to staging area\n";
+    std::cout << "  init [--object-format=<sha1|sha256>] Initialize a new MiniGit repository\n";
+    std::cout << "  add <file>...           Add files to staging area\n";
     std::cout << "  commit -m <message>     Commit staged changes\n";
     std::cout << "  log                     Show commit history\n";
     std::cout << "  branch <name>           Create a new branch\n";
@@ -16,6 +19,15 @@ void print_usage() {
     std::cout << "  merge <branch>          Merge branch into current branch\n";
     std::cout << "  diff <commit1> <commit2> Show differences between commits\n";
     std::cout << "  status                  Show repository status\n";
+    std::cout << "  config <key> [<value>]  Get or set a repository setting\n";
+    std::cout << "  repack [--geometric[=<n>]] Pack loose objects (and merge small packs)\n";
+    std::cout << "  maintenance <action>    run [--task=<name>] [--auto], start or stop\n";
+    std::cout << "  cat-file (-t|-s|-p) <object> Show an object's type, size or content\n";
+    std::cout << "  cat-file --batch[-check] Same for each id read from stdin\n";
+    std::cout << "  rev-list [--objects] <rev>... List commits (and blobs) reachable from revisions\n";
+    std::cout << "  fast-import             Import a history stream from stdin\n";
+    std::cout << "  fast-export <rev>...    Write the history of branches as a stream\n";
+    std::cout << "  fsck                    Verify object hashes and connectivity\n";
     std::cout << "  help                    Show this help message\n\n";
     std::cout << "Examples:\n";
     std::cout << "  minigit init\n";
@@ -26,7 +38,8 @@ void print_usage() {
     std::cout << "  minigit merge main\n";
 }
 
-void print_status(const MiniGit& git) {
+template <class Policy>
+void print_status(const BasicMiniGit<Policy>& git) {
     if (!git.is_repo_initialized()) {
         utils::print_error("Not a MiniGit repository");
         return;
@@ -56,31 +69,28 @@ void print_status(const MiniGit& git) {
     }
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        print_usage();
-        return 1;
-    }
+// Runs one command on the repository in the working directory, opened as
+// object format `Policy`
+template <class Policy>
+int run(const std::string& command, int argc, char* argv[]) {
+    BasicMiniGit<Policy> git;
     
-    std::string command = argv[1];
-    
-    if (command == "help" || command == "--help" || command == "-h") {
-        print_usage();
-        return 0;
+    // These stop their parallel stages between items on Ctrl-C and report
+    // it; other commands are left to end at once
+    if (command == "add" || command == "commit" || command == "diff") {
+        git.cancel_on_interrupt();
     }
     
-    MiniGit git;
-    
     if (command == "init") {
         if (!git.init()) {
             return 1;
         }
     } else if (command == "add") {
         if (argc < 3) {
-            utils::print_error("Usage: minigit add <file>");
+            utils::print_error("Usage: minigit add <file>...");
             return 1;
         }
-        if (!git.add(argv[2])) {
+        if (!git.add(std::vector<std::string>(argv + 2, argv + argc))) {
             return 1;
         }
     } else if (command == "commit") {
@@ -127,6 +137,104 @@ int main(int argc, char* argv[]) {
         if (!git.diff(argv[2], argv[3])) {
             return 1;
         }
+    } else if (command == "config") {
+        if (argc < 3) {
+            utils::print_error("Usage: minigit config <key> [<value>]");
+            return 1;
+        }
+        if (!git.config_value(argv[2], argc > 3 ? argv[3] : "")) {
+            return 1;
+        }
+    } else if (command == "repack") {
+        unsigned factor = 0;
+        if (argc > 2) {
+            std::string option = argv[2];
+            if (option == "--geometric") {
+                factor = 2;
+            } else if (option.starts_with("--geometric=")) {
+                // The whole value must be a number; anything else stays 0
+                auto [end, error] = std::from_chars(option.data() + 12, option.data() + option.size(), factor);
+                if (error != std::errc() || end != option.data() + option.size()) {
+                    factor = 0;
+                }
+            }
+            if (factor < 2) {
+                utils::print_error("Usage: minigit repack [--geometric[=<factor of at least 2>]]");
+                return 1;
+            }
+        }
+        if (!git.repack(factor)) {
+            return 1;
+        }
+    } else if (command == "maintenance") {
+        if (argc < 3) {
+            utils::print_error("Usage: minigit maintenance run [--task=<name>] [--auto] | start | stop");
+            return 1;
+        }
+        std::string task;
+        bool auto_only = false;
+        for (int i = 3; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option.starts_with("--task=")) {
+                task = option.substr(7);
+            } else if (option == "--auto") {
+                auto_only = true;
+            } else {
+                utils::print_error("Unknown option: " + option);
+                return 1;
+            }
+        }
+        if (!git.maintenance(argv[2], task, auto_only)) {
+            return 1;
+        }
+    } else if (command == "cat-file" && argc == 3 &&
+               (std::string(argv[2]) == "--batch" || std::string(argv[2]) == "--batch-check")) {
+        if (!git.cat_file_batch(std::string(argv[2]) == "--batch", std::cin, std::cout)) {
+            return 1;
+        }
+    } else if (command == "cat-file") {
+        if (argc < 4) {
+            utils::print_error("Usage: minigit cat-file (-t|-s|-p) <object>");
+            return 1;
+        }
+        if (!git.cat_file(argv[2], argv[3])) {
+            return 1;
+        }
+    } else if (command == "rev-list") {
+        bool objects = false;
+        std::vector<std::string> revisions;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--objects") {
+                objects = true;
+            } else {
+                revisions.push_back(arg);
+            }
+        }
+        if (revisions.empty()) {
+            utils::report_error("Usage: minigit rev-list [--objects] <rev>...");
+            return 1;
+        }
+        if (!git.rev_list(revisions, objects, std::cout)) {
+            return 1;
+        }
+    } else if (command == "fast-import") {
+        if (!git.fast_import(std::cin)) {
+            return 1;
+        }
+    } else if (command == "fast-export") {
+        std::vector<std::string> revisions(argv + 2, argv + argc);
+        if (revisions.empty()) {
+            utils::report_error("Usage: minigit fast-export <rev>...");
+            return 1;
+        }
+        if (!git.fast_export(revisions, std::cout)) {
+            return 1;
+        }
+    } else if (command == "fsck") {
+        if (!git.fsck()) {
+            return 1;
+        }
     } else if (command == "status") {
         print_status(git);
     } else {
@@ -136,4 +244,48 @@ int main(int argc, char* argv[]) {
     }
     
     return 0;
-} 
\ No newline at end of file
+} 
+
+int main(int argc, char* argv[]) {
+    // Nothing writes through C stdio, and the batch and stream commands
+    // move a lot of data through cin/cout. Must precede any output. Unsynced,
+    // cin buffers its input, so a batch can see which ids are waiting;
+    // untied, reading it does not flush cout, which cat-file --batch does
+    // itself after each batch.
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+    
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    
+    std::string command = argv[1];
+    
+    if (command == "help" || command == "--help" || command == "-h") {
+        print_usage();
+        return 0;
+    }
+    
+    // The object format is decided once, here: by init's option for a new
+    // repository, otherwise by the repository's config
+    ObjectFormat format = ObjectFormat::Sha1;
+    if (command == "init" && argc > 2) {
+        std::string option = argv[2];
+        if (argc > 3 || !option.starts_with("--object-format=") ||
+            !parse_object_format(option.substr(16), format)) {
+            utils::print_error("Usage: minigit init [--object-format=<sha1|sha256>]");
+            return 1;
+        }
+    } else if (!read_object_format(".", format)) {
+        return 1;
+    }
+    
+    // Bind SIMD kernels before any worker threads start
+    cpu::kernels();
+    
+    switch (format) {
+    case ObjectFormat::Sha256: return run<Sha256Policy>(command, argc, argv);
+    default: return run<Sha1Policy>(command, argc, argv);
+    }
+}
@@ -0,0 +1,246 @@
+#include "minigit.h"
+#include "utils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <ctime>
+#include <set>
+
+namespace {
+
+// A lock older than this is assumed to belong to a process that died
+const std::time_t STALE_LOCK_SECONDS = 3600;
+
+// Holds .minigit/maintenance.lock for its lifetime. The file is created
+// exclusively, so at most one maintenance run works on a repository.
+class MaintenanceLock {
+private:
+    std::string path;
+    bool held = false;
+
+    bool try_create() {
+        std::FILE* file = std::fopen(path.c_str(), "wx");
+        if (!file) {
+            return false;
+        }
+        std::fprintf(file, "%lld\n", static_cast<long long>(std::time(nullptr)));
+        std::fclose(file);
+        return true;
+    }
+
+    static bool is_stale(const std::string& lock) {
+        std::time_t started = std::atoll(utils::read_file(lock).c_str());
+        return started > 0 && std::time(nullptr) - started > STALE_LOCK_SECONDS;
+    }
+
+public:
+    explicit MaintenanceLock(const std::string& path) : path(path) {
+        held = try_create();
+        if (held || !is_stale(path)) {
+            return;
+        }
+        // Move the stale lock aside before removing it: of several
+        // processes breaking it, only the one whose rename succeeds
+        // retries. What it moved is checked again, as a live lock may have
+        // replaced the stale one in between; that one is put back.
+        std::string aside = utils::temp_path(path);
+        std::error_code ec;
+        std::filesystem::rename(path, aside, ec);
+        if (ec) {
+            return;
+        }
+        if (!is_stale(aside)) {
+            std::filesystem::rename(aside, path, ec);
+            return;
+        }
+        std::filesystem::remove(aside, ec);
+        held = try_create();
+    }
+
+    ~MaintenanceLock() {
+        if (held) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    bool is_held() const { return held; }
+};
+
+} // namespace
+
+// Branch heads plus HEAD, which may be detached
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::reference_tips() const {
+    std::set<std::string> tips;
+    for (const auto& [_, branch] : branches) {
+        if (!branch->get_commit_hash().empty()) {
+            tips.insert(branch->get_commit_hash());
+        }
+    }
+    std::string head = load_head();
+    if (!head.empty()) {
+        tips.insert(head);
+    }
+    return std::vector<std::string>(tips.begin(), tips.end());
+}
+
+// Commits reachable from a reference that the commit-graph does not cover,
+// collecting no more than `limit`. The walk stops at covered commits, so
+// its cost follows the number of new commits, not the history size.
+template <class Policy>
+std::vector<typename BasicCommitGraph<Policy>::Entry> BasicMiniGit<Policy>::commits_outside_graph(size_t limit) {
+    const CommitGraphChain& graph = commit_graph();
+    std::vector<typename CommitGraph::Entry> entries;
+    std::set<std::string> seen;
+    std::vector<std::string> pending = reference_tips();
+    while (!pending.empty() && entries.size() < limit) {
+        std::string hash = pending.back();
+        pending.pop_back();
+        std::uint32_t position = 0;
+        if (graph.find(hash, position) || !seen.insert(hash).second) {
+            continue;
+        }
+        auto commit = load_commit(hash);
+        if (!commit) {
+            continue;
+        }
+        entries.push_back({hash, commit->get_parents(), commit->get_timestamp()});
+        for (const auto& parent : commit->get_parents()) {
+            pending.push_back(parent);
+        }
+    }
+    return entries;
+}
+
+// Adds the commits missing from the commit-graph as a new layer;
+// commitGraph.splitRatio (default 2) controls when layers merge
+template <class Policy>
+bool BasicMiniGit<Policy>::update_commit_graph() {
+    std::vector<typename CommitGraph::Entry> entries = commits_outside_graph(SIZE_MAX);
+    if (entries.empty()) {
+        return true;
+    }
+    commit_graph();
+    unsigned ratio = static_cast<unsigned>(std::max<std::int64_t>(2, config.get_int("commitGraph.splitRatio", 2)));
+    return graph->append(entries, ratio);
+}
+
+// Tasks run in this order. Each has a maintenance.<task>.auto threshold
+// for --auto runs; 0 disables the task there.
+template <class Policy>
+bool BasicMiniGit<Policy>::run_maintenance(const std::string& only_task, bool auto_only) {
+    struct MaintenanceTask {
+        const char* name;
+        std::int64_t default_threshold;
+        size_t (*measure)(BasicMiniGit&, size_t limit);
+        bool (*run)(BasicMiniGit&);
+    };
+    static const MaintenanceTask tasks[] = {
+        {"commit-graph", 100,
+         [](BasicMiniGit& git, size_t limit) { return git.commits_outside_graph(limit).size(); },
+         [](BasicMiniGit& git) { return git.update_commit_graph(); }},
+        {"loose-objects", 100,
+         [](BasicMiniGit& git, size_t) { return git.list_loose_objects().size(); },
+         [](BasicMiniGit& git) { return git.repack(); }},
+        {"incremental-repack", 10,
+         [](BasicMiniGit& git, size_t) { return git.packs().get_packs().size(); },
+         [](BasicMiniGit& git) { return git.repack(2); }},
+    };
+
+    bool known = only_task.empty();
+    for (const auto& task : tasks) {
+        known = known || only_task == task.name;
+    }
+    if (!known) {
+        utils::print_error("Unknown maintenance task: " + only_task);
+        return false;
+    }
+
+    MaintenanceLock lock(minigit_path + "/maintenance.lock");
+    if (!lock.is_held()) {
+        if (!auto_only) {
+            utils::print_error("Another maintenance process is running");
+        }
+        return auto_only;
+    }
+
+    bool ok = true;
+    for (const auto& task : tasks) {
+        if (!only_task.empty() && only_task != task.name) {
+            continue;
+        }
+        if (auto_only) {
+            std::int64_t threshold = config.get_int(std::string("maintenance.") + task.name + ".auto",
+                                                    task.default_threshold);
+            if (threshold <= 0 || task.measure(*this, static_cast<size_t>(threshold)) < static_cast<size_t>(threshold)) {
+                continue;
+            }
+        }
+        utils::print_info(std::string("Running maintenance task ") + task.name);
+        if (!task.run(*this)) {
+            utils::print_error(std::string("Maintenance task ") + task.name + " failed");
+            ok = false;
+        }
+    }
+
+    config.set("maintenance.lastRun", std::to_string(std::time(nullptr)));
+    config.save();
+    return ok;
+}
+
+// Scheduling without a daemon: once `maintenance start` has enabled it,
+// commands that add history check whether maintenance.interval seconds
+// (default one hour) have passed since the last run and, if so, run the
+// tasks that are due. Checking costs one config lookup.
+template <class Policy>
+void BasicMiniGit<Policy>::maybe_run_maintenance() {
+    if (!config.get_bool("maintenance.auto", false)) {
+        return;
+    }
+    std::time_t last_run = static_cast<std::time_t>(config.get_int("maintenance.lastRun", 0));
+    std::time_t interval = static_cast<std::time_t>(config.get_int("maintenance.interval", 3600));
+    if (std::time(nullptr) - last_run < interval) {
+        return;
+    }
+    run_maintenance("", true);
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::maintenance(const std::string& action, const std::string& task, bool auto_only) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+
+    if (action == "run") {
+        return run_maintenance(task, auto_only);
+    }
+    if (action == "start" || action == "stop") {
+        config.set("maintenance.auto", action == "start" ? "true" : "false");
+        if (!config.save()) {
+            utils::print_error("Failed to update configuration");
+            return false;
+        }
+        utils::print_success(action == "start" ? "Scheduled maintenance enabled" : "Scheduled maintenance disabled");
+        return true;
+    }
+
+    utils::print_error("Unknown maintenance action: " + action);
+    return false;
+}
+
+template std::vector<std::string> BasicMiniGit<Sha1Policy>::reference_tips() const;
+template std::vector<BasicCommitGraph<Sha1Policy>::Entry> BasicMiniGit<Sha1Policy>::commits_outside_graph(size_t);
+template bool BasicMiniGit<Sha1Policy>::update_commit_graph();
+template bool BasicMiniGit<Sha1Policy>::run_maintenance(const std::string&, bool);
+template void BasicMiniGit<Sha1Policy>::maybe_run_maintenance();
+template bool BasicMiniGit<Sha1Policy>::maintenance(const std::string&, const std::string&, bool);
+
+template std::vector<std::string> BasicMiniGit<Sha256Policy>::reference_tips() const;
+template std::vector<BasicCommitGraph<Sha256Policy>::Entry> BasicMiniGit<Sha256Policy>::commits_outside_graph(size_t);
+template bool BasicMiniGit<Sha256Policy>::update_commit_graph();
+template bool BasicMiniGit<Sha256Policy>::run_maintenance(const std::string&, bool);
+template void BasicMiniGit<Sha256Policy>::maybe_run_maintenance();
+template bool BasicMiniGit<Sha256Policy>::maintenance(const std::string&, const std::string&, bool);
@@ -1,544 +1,1460 @@
-#include "minigit.h"
-#include "utils.h"
-#include <algorithm>
-#include <set>
-
-MiniGit::MiniGit(const std::string& path) 
-    : repo_path(path), is_initialized(false) {
-    minigit_path = repo_path + "/.minigit";
-    objects_path = minigit_path + "/objects";
-    refs_path = minigit_path + "/refs";
-    head_path = minigit_path + "/HEAD";
-    
-    // Check if already initialized
-    if (utils::directory_exists(minigit_path)) {
-        is_initialized = true;
-        current_branch = "main";
-        
-        // Load existing branches
-        std::vector<std::string> branch_files = utils::list_files(refs_path);
-        for (const auto& branch_file : branch_files) {
-            std::string branch_name = branch_file;
-            std::string branch_path = refs_path + "/" + branch_file;
-            std::string branch_data = utils::read_file(branch_path);
-            if (!branch_data.empty()) {
-                auto branch = Branch::from_string(branch_data);
-                if (branch) {
-                    branches[branch_name] = branch;
-                }
-            }
-        }
-    }
-}
-
-bool MiniGit::init() {
-    if (is_initialized) {
-        utils::print_warning("MiniGit repository already initialized");
-        return true;
-    }
-    
-    create_directory_structure();
-    
-    // Create initial branch
-    current_branch = "main";
-    auto main_branch = std::make_shared<Branch>("main");
-    branches["main"] = main_branch;
-    save_branch(main_branch);
-    
-    is_initialized = true;
-    utils::print_success("Initialized empty MiniGit repository");
-    return true;
-}
-
-void MiniGit::create_directory_structure() {
-    utils::create_directory(minigit_path);
-    utils::create_directory(objects_path);
-    utils::create_directory(refs_path);
-}
-
-std::string MiniGit::compute_hash(const std::string& content) {
-    return utils::sha1_hash(content);
-}
-
-void MiniGit::save_blob(const std::shared_ptr<Blob>& blob) {
-    std::string blob_path = objects_path + "/" + blob->get_hash();
-    utils::write_file(blob_path, blob->to_string());
-}
-
-std::shared_ptr<Blob> MiniGit::load_blob(const std::string& hash) {
-    std::string blob_path = objects_path + "/" + hash;
-    std::string blob_data = utils::read_file(blob_path);
-    if (blob_data.empty()) {
-        return nullptr;
-    }
-    return Blob::from_string(blob_data);
-}
-
-void MiniGit::save_commit(const std::shared_ptr<Commit>& commit) {
-    std::string commit_path = objects_path + "/" + commit->get_hash();
-    utils::write_file(commit_path, commit->to_string());
-}
-
-std::shared_ptr<Commit> MiniGit::load_commit(const std::string& hash) {
-    std::string commit_path = objects_path + "/" + hash;
-    std::string commit_data = utils::read_file(commit_path);
-    if (commit_data.empty()) {
-        return nullptr;
-    }
-    return Commit::from_string(commit_data);
-}
-
-void MiniGit::save_head(const std::string& commit_hash) {
-    utils::write_file(head_path, commit_hash);
-}
-
-std::string MiniGit::load_head() {
-    return utils::read_file(head_path);
-}
-
-void MiniGit::save_branch(const std::shared_ptr<Branch>& branch) {
-    std::string branch_path = refs_path + "/" + branch->get_name();
-    utils::write_file(branch_path, branch->to_string());
-}
-
-std::shared_ptr<Branch> MiniGit::load_branch(const std::string& name) {
-    std::string branch_path = refs_path + "/" + name;
-    std::string branch_data = utils::read_file(branch_path);
-    if (branch_data.empty()) {
-        return nullptr;
-    }
-    return Branch::from_string(branch_data);
-}
-
-bool MiniGit::add(const std::string& filename) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    if (!utils::file_exists(filename)) {
-        utils::print_error("File '" + filename + "' does not exist");
-        return false;
-    }
-    
-    std::string content = utils::read_file(filename);
-    auto blob = std::make_shared<Blob>(content, filename);
-    staging_area[filename] = blob;
-    
-    utils::print_success("Added '" + filename + "' to staging area");
-    return true;
-}
-
-bool MiniGit::commit(const std::string& message) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    if (staging_area.empty()) {
-        utils::print_error("No changes staged for commit");
-        return false;
-    }
-    
-    // Create commit
-    auto commit = std::make_shared<Commit>(message);
-    
-    // Add parent commit if exists
-    std::string head_commit = load_head();
-    if (!head_commit.empty()) {
-        commit->add_parent(head_commit);
-    }
-    
-    // Add staged files
-    for (const auto& [filename, blob] : staging_area) {
-        save_blob(blob);
-        commit->add_file(filename, blob->get_hash());
-    }
-    
-    // Save commit
-    save_commit(commit);
-    
-    // Update HEAD and current branch
-    save_head(commit->get_hash());
-    if (branches.find(current_branch) != branches.end()) {
-        branches[current_branch]->set_commit_hash(commit->get_hash());
-        save_branch(branches[current_branch]);
-    }
-    
-    // Clear staging area
-    staging_area.clear();
-    
-    utils::print_success("Committed " + std::to_string(commit->get_files().size()) + " files");
-    utils::print_info("Commit: " + commit->get_hash().substr(0, 8));
-    return true;
-}
-
-bool MiniGit::log() {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    std::string current_commit_hash = load_head();
-    if (current_commit_hash.empty()) {
-        utils::print_info("No commits yet");
-        return true;
-    }
-    
-    std::string commit_hash = current_commit_hash;
-    int commit_count = 0;
-    
-    while (!commit_hash.empty()) {
-        auto commit = load_commit(commit_hash);
-        if (!commit) {
-            break;
-        }
-        
-        std::cout << "\ncommit " << commit->get_hash() << std::endl;
-        std::cout << "Author: " << commit->get_author() << std::endl;
-        std::cout << "Date:   " << utils::timestamp_to_string(commit->get_timestamp()) << std::endl;
-        std::cout << std::endl;
-        std::cout << "    " << commit->get_message() << std::endl;
-        
-        if (commit->is_initial_commit()) {
-            break;
-        }
-        
-        commit_hash = commit->get_parents().empty() ? "" : commit->get_parents()[0];
-        commit_count++;
-        
-        if (commit_count > 100) { // Prevent infinite loops
-            break;
-        }
-    }
-    
-    return true;
-}
-
-bool MiniGit::branch(const std::string& branch_name) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    if (branches.find(branch_name) != branches.end()) {
-        utils::print_error("Branch '" + branch_name + "' already exists");
-        return false;
-    }
-    
-    std::string current_commit = load_head();
-    auto new_branch = std::make_shared<Branch>(branch_name, current_commit);
-    branches[branch_name] = new_branch;
-    save_branch(new_branch);
-    
-    utils::print_success("Created branch '" + branch_name + "'");
-    return true;
-}
-
-bool MiniGit::checkout(const std::string& target) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    // Check if target is a branch
-    if (branches.find(target) != branches.end()) {
-        current_branch = target;
-        std::string commit_hash = branches[target]->get_commit_hash();
-        if (!commit_hash.empty()) {
-            save_head(commit_hash);
-        }
-        utils::print_success("Switched to branch '" + target + "'");
-        return true;
-    }
-    
-    // Check if target is a commit hash
-    auto commit = load_commit(target);
-    if (commit) {
-        save_head(target);
-        utils::print_success("Switched to commit " + target.substr(0, 8));
-        return true;
-    }
-    
-    utils::print_error("Target '" + target + "' not found");
-    return false;
-}
-
-std::vector<std::string> MiniGit::get_commit_ancestors(const std::string& commit_hash) {
-    std::vector<std::string> ancestors;
-    std::string current = commit_hash;
-    
-    while (!current.empty()) {
-        auto commit = load_commit(current);
-        if (!commit) {
-            break;
-        }
-        
-        ancestors.push_back(current);
-        
-        if (commit->is_initial_commit()) {
-            break;
-        }
-        
-        current = commit->get_parents().empty() ? "" : commit->get_parents()[0];
-    }
-    
-    return ancestors;
-}
-
-std::string MiniGit::find_lowest_common_ancestor(const std::string& commit1_hash, const std::string& commit2_hash) {
-    auto ancestors1 = get_commit_ancestors(commit1_hash);
-    auto ancestors2 = get_commit_ancestors(commit2_hash);
-    
-    std::set<std::string> set1(ancestors1.begin(), ancestors1.end());
-    
-    for (const auto& ancestor : ancestors2) {
-        if (set1.find(ancestor) != set1.end()) {
-            return ancestor;
-        }
-    }
-    
-    return "";
-}
-
-std::map<std::string, std::string> MiniGit::get_file_changes(const std::string& from_hash, const std::string& to_hash) {
-    std::map<std::string, std::string> changes;
-    
-    auto from_commit = load_commit(from_hash);
-    auto to_commit = load_commit(to_hash);
-    
-    if (!from_commit || !to_commit) {
-        return changes;
-    }
-    
-    auto from_files = from_commit->get_files();
-    auto to_files = to_commit->get_files();
-    
-    // Find changed files
-    for (const auto& [filename, blob_hash] : to_files) {
-        auto it = from_files.find(filename);
-        if (it == from_files.end() || it->second != blob_hash) {
-            changes[filename] = blob_hash;
-        }
-    }
-    
-    return changes;
-}
-
-std::string MiniGit::merge_files(const std::string& base_content, const std::string& ours_content, const std::string& theirs_content) {
-    if (ours_content == theirs_content) {
-        return ours_content;
-    }
-    
-    if (base_content == ours_content) {
-        return theirs_content;
-    }
-    
-    if (base_content == theirs_content) {
-        return ours_content;
-    }
-    
-    // Simple merge strategy: append conflict markers
-    std::string merged = base_content;
-    merged += "\n<<<<<<< HEAD\n";
-    merged += ours_content;
-    merged += "\n=======\n";
-    merged += theirs_content;
-    merged += "\n>>>>>>> MERGE\n";
-    
-    return merged;
-}
-
-bool MiniGit::merge(const std::string& branch_name) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    if (branches.find(branch_name) == branches.end()) {
-        utils::print_error("Branch '" + branch_name + "' does not exist");
-        return false;
-    }
-    
-    std::string current_commit = load_head();
-    std::string target_commit = branches[branch_name]->get_commit_hash();
-    
-    if (current_commit == target_commit) {
-        utils::print_info("Already up to date");
-        return true;
-    }
-    
-    // Find lowest common ancestor
-    std::string lca = find_lowest_common_ancestor(current_commit, target_commit);
-    if (lca.empty()) {
-        utils::print_error("No common ancestor found");
-        return false;
-    }
-    
-    // Get changes from LCA to current and target
-    auto current_changes = get_file_changes(lca, current_commit);
-    auto target_changes = get_file_changes(lca, target_commit);
-    
-    bool has_conflicts = false;
-    std::map<std::string, std::string> merged_files;
-    
-    // Merge files
-    for (const auto& [filename, blob_hash] : target_changes) {
-        auto current_it = current_changes.find(filename);
-        
-        if (current_it == current_changes.end()) {
-            // File only changed in target branch
-            merged_files[filename] = blob_hash;
-        } else if (current_it->second == blob_hash) {
-            // Same change in both branches
-            merged_files[filename] = blob_hash;
-        } else {
-            // Conflict - both branches modified the file
-            has_conflicts = true;
-            utils::print_warning("CONFLICT: both modified " + filename);
-            
-            // Load the three versions
-            auto base_blob = load_blob(load_commit(lca)->get_files().at(filename));
-            auto ours_blob = load_blob(current_it->second);
-            auto theirs_blob = load_blob(blob_hash);
-            
-            if (base_blob && ours_blob && theirs_blob) {
-                std::string merged_content = merge_files(
-                    base_blob->get_content(),
-                    ours_blob->get_content(),
-                    theirs_blob->get_content()
-                );
-                
-                auto merged_blob = std::make_shared<Blob>(merged_content, filename);
-                save_blob(merged_blob);
-                merged_files[filename] = merged_blob->get_hash();
-            }
-        }
-    }
-    
-    // Add files that only changed in current branch
-    for (const auto& [filename, blob_hash] : current_changes) {
-        if (target_changes.find(filename) == target_changes.end()) {
-            merged_files[filename] = blob_hash;
-        }
-    }
-    
-    // Create merge commit
-    std::string merge_message = "Merge branch '" + branch_name + "' into " + current_branch;
-    auto merge_commit = std::make_shared<Commit>(merge_message);
-    merge_commit->add_parent(current_commit);
-    merge_commit->add_parent(target_commit);
-    
-    // Add all merged files
-    for (const auto& [filename, blob_hash] : merged_files) {
-        merge_commit->add_file(filename, blob_hash);
-    }
-    
-    // Save merge commit
-    save_commit(merge_commit);
-    save_head(merge_commit->get_hash());
-    
-    // Update current branch
-    if (branches.find(current_branch) != branches.end()) {
-        branches[current_branch]->set_commit_hash(merge_commit->get_hash());
-        save_branch(branches[current_branch]);
-    }
-    
-    if (has_conflicts) {
-        utils::print_warning("Merge completed with conflicts");
-    } else {
-        utils::print_success("Merge completed successfully");
-    }
-    
-    return true;
-}
-
-bool MiniGit::diff(const std::string& commit1, const std::string& commit2) {
-    if (!is_initialized) {
-        utils::print_error("Not a MiniGit repository");
-        return false;
-    }
-    
-    auto commit1_obj = load_commit(commit1);
-    auto commit2_obj = load_commit(commit2);
-    
-    if (!commit1_obj || !commit2_obj) {
-        utils::print_error("Invalid commit hash");
-        return false;
-    }
-    
-    auto files1 = commit1_obj->get_files();
-    auto files2 = commit2_obj->get_files();
-    
-    std::set<std::string> all_files;
-    for (const auto& [filename, _] : files1) {
-        all_files.insert(filename);
-    }
-    for (const auto& [filename, _] : files2) {
-        all_files.insert(filename);
-    }
-    
-    for (const auto& filename : all_files) {
-        auto it1 = files1.find(filename);
-        auto it2 = files2.find(filename);
-        
-        if (it1 == files1.end()) {
-            // File added in commit2
-            auto blob2 = load_blob(it2->second);
-            if (blob2) {
-                std::cout << "diff --git a/" << filename << " b/" << filename << std::endl;
-                std::cout << "new file mode 100644" << std::endl;
-                std::cout << "--- /dev/null" << std::endl;
-                std::cout << "+++ b/" << filename << std::endl;
-                
-                auto lines = utils::split(blob2->get_content(), '\n');
-                for (const auto& line : lines) {
-                    std::cout << "+" << line << std::endl;
-                }
-            }
-        } else if (it2 == files2.end()) {
-            // File deleted in commit2
-            auto blob1 = load_blob(it1->second);
-            if (blob1) {
-                std::cout << "diff --git a/" << filename << " b/" << filename << std::endl;
-                std::cout << "deleted file mode 100644" << std::endl;
-                std::cout << "--- a/" << filename << std::endl;
-                std::cout << "+++ /dev/null" << std::endl;
-                
-                auto lines = utils::split(blob1->get_content(), '\n');
-                for (const auto& line : lines) {
-                    std::cout << "-" << line << std::endl;
-                }
-            }
-        } else if (it1->second != it2->second) {
-            // File modified
-            auto blob1 = load_blob(it1->second);
-            auto blob2 = load_blob(it2->second);
-            
-            if (blob1 && blob2) {
-                std::cout << "diff --git a/" << filename << " b/" << filename << std::endl;
-                std::cout << "--- a/" << filename << std::endl;
-                std::cout << "+++ b/" << filename << std::endl;
-                
-                auto diff_lines = utils::compute_diff(blob1->get_content(), blob2->get_content());
-                for (const auto& line : diff_lines) {
-                    std::cout << line << std::endl;
-                }
-            }
-        }
-    }
-    
-    return true;
-}
-
-std::vector<std::string> MiniGit::get_branches() const {
-    std::vector<std::string> branch_names;
-    for (const auto& [name, _] : branches) {
-        branch_names.push_back(name);
-    }
-    return branch_names;
-}
-
-std::string MiniGit::get_head_commit() const {
-    return load_head();
-} 
+#include "minigit.h"
+#include "utils.h"
+#include "task.h"
+#include "channel.h"
+#include "pack_builder.h"
+#include "sha1_multi.h"
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <cctype>
+#include <type_traits>
+
+template <class Policy>
+BasicMiniGit<Policy>::BasicMiniGit(const std::string& path) 
+    : repo_path(path), is_initialized(false) {
+    minigit_path = repo_path + "/.minigit";
+    objects_path = minigit_path + "/objects";
+    refs_path = minigit_path + "/refs";
+    head_path = minigit_path + "/HEAD";
+    large_path = minigit_path + "/large";
+    pack_path = objects_path + "/pack";
+    config = Config(minigit_path + "/config");
+    
+    // Check if already initialized
+    if (utils::directory_exists(minigit_path)) {
+        config.load();
+        
+        // Object names, the pack store and the commit-graph are bound to
+        // Policy at compile time; main() opens each repository as its own
+        // format (read_object_format), and any other is refused rather than
+        // misread.
+        std::string format_name = config.get("extensions.objectFormat", Sha1Policy::NAME);
+        if (format_name != Policy::NAME) {
+            utils::print_error("Repository uses object format '" + format_name + "', not " + Policy::NAME);
+            return;
+        }
+        is_initialized = true;
+        current_branch = "main";
+        
+        // Only takes effect if nothing has used the shared pool yet
+        Executor::configure_shared(thread_count());
+        
+        // Load existing branches
+        std::vector<std::string> branch_files = utils::list_files(refs_path);
+        for (const auto& branch_file : branch_files) {
+            std::string branch_name = branch_file;
+            std::string branch_path = refs_path + "/" + branch_file;
+            std::string branch_data = utils::read_file(branch_path);
+            if (!branch_data.empty()) {
+                auto branch = Branch::from_string(branch_data);
+                if (branch) {
+                    branches[branch_name] = branch;
+                }
+            }
+        }
+    }
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::init() {
+    if (is_initialized) {
+        utils::print_warning("MiniGit repository already initialized");
+        return true;
+    }
+    // A repository that exists but was not opened has another object format
+    if (utils::directory_exists(minigit_path)) {
+        return false;
+    }
+    
+    create_directory_structure();
+    config.set("extensions.objectFormat", Policy::NAME);
+    if (!config.save()) {
+        utils::print_error("Failed to write configuration");
+        return false;
+    }
+    
+    // Create initial branch
+    current_branch = "main";
+    auto main_branch = std::make_shared<Branch>("main");
+    branches["main"] = main_branch;
+    save_branch(main_branch);
+    
+    is_initialized = true;
+    utils::print_success("Initialized empty MiniGit repository");
+    return true;
+}
+
+template <class Policy>
+void BasicMiniGit<Policy>::create_directory_structure() {
+    utils::create_directory(minigit_path);
+    utils::create_directory(objects_path);
+    utils::create_directory(refs_path);
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::is_object_id(const std::string& hash) {
+    ObjectId<Policy> id;
+    return ObjectId<Policy>::parse(hash, id);
+}
+
+// sha1_multi hashes a group of inputs in the lanes of a vector register;
+// other formats hash one input at a time
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::hash_all(const std::vector<std::string_view>& inputs) {
+    if constexpr (std::is_same_v<Policy, Sha1Policy>) {
+        return sha1_multi::hash(inputs);
+    } else {
+        std::vector<std::string> digests;
+        unsigned char digest[Policy::DIGEST_SIZE];
+        for (const auto& input : inputs) {
+            HashContext<Policy>::digest(input.data(), input.size(), digest);
+            digests.push_back(utils::hex_encode(digest, Policy::DIGEST_SIZE));
+        }
+        return digests;
+    }
+}
+
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::hash_objects(const std::string& type,
+                                                           const std::vector<std::string_view>& payloads) {
+    if constexpr (std::is_same_v<Policy, Sha1Policy>) {
+        return sha1_multi::hash_objects(type, payloads);
+    } else {
+        std::vector<std::string> digests;
+        HashContext<Policy> context;
+        unsigned char digest[Policy::DIGEST_SIZE];
+        for (const auto& payload : payloads) {
+            std::string header = utils::object_header(type, payload.size());
+            context.reset();
+            context.update(header.data(), header.size());
+            context.update(payload.data(), payload.size());
+            context.finish(digest);
+            digests.push_back(utils::hex_encode(digest, Policy::DIGEST_SIZE));
+        }
+        return digests;
+    }
+}
+
+// core.threads: 0 for one thread per CPU. Past a few threads per CPU a
+// bigger pool only adds contention, so larger values are capped.
+template <class Policy>
+unsigned BasicMiniGit<Policy>::thread_count() const {
+    const std::int64_t MAX_PER_CPU = 4;
+    std::int64_t threads = config.get_int("core.threads", 0);
+    std::int64_t limit = MAX_PER_CPU * std::max(1u, std::thread::hardware_concurrency());
+    if (threads < 0) {
+        utils::print_warning("core.threads is negative; using one thread per CPU");
+        return 0;
+    }
+    if (threads > limit) {
+        utils::print_warning("core.threads capped at " + std::to_string(limit));
+        return static_cast<unsigned>(limit);
+    }
+    return static_cast<unsigned>(threads);
+}
+
+// Created on first use so commands that never touch objects in bulk pay
+// nothing. core.ioEngine selects io_uring, threads or auto; core.ioQueueDepth
+// bounds how many operations are in flight.
+template <class Policy>
+IoEngine& BasicMiniGit<Policy>::io_engine() const {
+    if (!io) {
+        io = IoEngine::create(config.get("core.ioEngine", "auto"), io_queue_depth());
+    }
+    return *io;
+}
+
+// core.ioQueueDepth, clamped to [1, 4096]: it sizes the io_uring rings and
+// the commit pipeline's write batches
+template <class Policy>
+unsigned BasicMiniGit<Policy>::io_queue_depth() const {
+    const std::int64_t MAX_DEPTH = 4096;
+    return static_cast<unsigned>(std::clamp<std::int64_t>(config.get_int("core.ioQueueDepth", 64), 1, MAX_DEPTH));
+}
+
+// Loaded once, on first use; repack() reloads it after changing packs.
+// call_once because pipeline stages look objects up concurrently.
+// core.packedGitWindowSize and core.packedGitLimit size the mapped pack
+// windows; core.deltaBaseCacheLimit bounds the delta base cache.
+template <class Policy>
+BasicPackStore<Policy>& BasicMiniGit<Policy>::packs() const {
+    std::call_once(pack_store_loaded, [this] {
+        pack_store = std::make_unique<PackStore>(
+            pack_path,
+            static_cast<size_t>(config.get_int("core.packedGitWindowSize", 32LL << 20)),
+            static_cast<size_t>(config.get_int("core.packedGitLimit", 256LL << 20)),
+            static_cast<size_t>(config.get_int("core.deltaBaseCacheLimit", 96LL << 20)));
+        pack_store->load();
+    });
+    return *pack_store;
+}
+
+// Packed objects are found in the mapped indexes; otherwise a single stat,
+// the object is never opened. Objects are content-addressed, so one that
+// exists never needs to be written again.
+template <class Policy>
+bool BasicMiniGit<Policy>::has_object(const std::string& hash) const {
+    if (packs().has(hash)) {
+        return true;
+    }
+    std::error_code ec;
+    return std::filesystem::is_regular_file(objects_path + "/" + hash, ec);
+}
+
+// Loaded lazily; update_commit_graph() reloads it after adding a layer.
+template <class Policy>
+const BasicCommitGraphChain<Policy>& BasicMiniGit<Policy>::commit_graph() const {
+    if (!graph) {
+        graph = std::make_unique<CommitGraphChain>(objects_path + "/info");
+        graph->load();
+    }
+    return *graph;
+}
+
+// Loose objects are zlib-compressed when core.compression is above 0
+// (default 0: stored as plain text). Both forms are always readable.
+template <class Policy>
+int BasicMiniGit<Policy>::compression_level() const {
+    return static_cast<int>(config.get_int("core.compression", 0));
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::encode_object(const std::string& data) const {
+    int level = compression_level();
+    return level > 0 ? utils::compress(data, level) : data;
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::decode_object(const std::string& data) {
+    return utils::is_compressed(data) ? utils::decompress(data) : data;
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::read_object(const std::string& hash) const {
+    PackLocation location;
+    if (packs().find(hash, location)) {
+        return location.pack->read(location.offset);
+    }
+    return decode_object(utils::read_file(objects_path + "/" + hash));
+}
+
+// Loose headers are read from the first few KB of the file, inflating
+// only what they need; objects whose header does not settle the size
+// (compressed commits, damaged entries) are read whole.
+template <class Policy>
+bool BasicMiniGit<Policy>::object_info(const std::string& hash, ObjectInfo& info) const {
+    const size_t LOOSE_PREFIX = 4096;
+    const size_t HEADER_PREFIX = 256;
+    PackLocation location;
+    if (packs().find(hash, location)) {
+        if (location.pack->read_info(location.offset, info)) {
+            return true;
+        }
+    } else {
+        std::string path = objects_path + "/" + hash;
+        std::string head = utils::read_file_range(path, 0, LOOSE_PREFIX);
+        bool compressed = utils::is_compressed(head);
+        std::string prefix = compressed
+            ? utils::decompress_prefix(reinterpret_cast<const unsigned char*>(head.data()), head.size(), HEADER_PREFIX)
+            : head.substr(0, HEADER_PREFIX);
+        if (object_info_of(prefix, compressed ? 0 : utils::file_size(path), info)) {
+            return true;
+        }
+    }
+    std::string data = read_object(hash);
+    return !data.empty() && object_info_of(data, data.size(), info);
+}
+
+// Reads many objects in one pass. Packed objects are read in (pack, offset)
+// order; loose ones are sorted by inode, which on common filesystems tracks
+// allocation order, so the reads run roughly sequentially instead of in the
+// caller's (usually map) order.
+template <class Policy>
+void BasicMiniGit<Policy>::load_objects(const std::vector<std::string>& hashes, const ObjectCallback& callback) const {
+    std::vector<std::pair<std::uint64_t, std::string>> requests;
+    std::vector<std::tuple<std::string, std::uint64_t, const Pack*, std::string>> packed;
+    std::set<std::string> seen;
+    for (const auto& hash : hashes) {
+        if (!seen.insert(hash).second) {
+            continue;
+        }
+        PackLocation location;
+        if (packs().find(hash, location)) {
+            packed.emplace_back(location.pack->get_name(), location.offset, location.pack, hash);
+        } else {
+            requests.emplace_back(utils::file_inode(objects_path + "/" + hash), hash);
+        }
+    }
+    
+    std::sort(packed.begin(), packed.end());
+    for (const auto& [_, offset, pack, hash] : packed) {
+        callback(hash, pack->read(offset));
+    }
+    
+    std::sort(requests.begin(), requests.end());
+    
+    std::vector<IoRequest> reads(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        reads[i].path = objects_path + "/" + requests[i].second;
+    }
+    io_engine().read_files(reads);
+    
+    for (size_t i = 0; i < requests.size(); ++i) {
+        callback(requests[i].second, decode_object(reads[i].data));
+    }
+}
+
+// Large content was copied into the large-object store by add; the object
+// itself is only a stub recording the size.
+template <class Policy>
+bool BasicMiniGit<Policy>::save_blob(const std::shared_ptr<Blob>& blob) {
+    if (has_object(blob->get_hash())) {
+        return true;
+    }
+    if (blob->is_large() && !utils::file_exists(large_path + "/" + blob->get_hash())) {
+        utils::print_error("Large file '" + blob->get_filename() + "' is missing from the store");
+        return false;
+    }
+    
+    // Written beside the object and renamed into place: has_object only
+    // stats the path, so a torn write must never appear under the id
+    std::string blob_path = objects_path + "/" + blob->get_hash();
+    if (!utils::write_file_atomic(blob_path, encode_object(blob->to_string()))) {
+        utils::print_error("Failed to write object " + blob->get_hash());
+        return false;
+    }
+    return true;
+}
+
+// Copies a large file into the large-object store while hashing it, so
+// the stored bytes are the ones the id covers even if the working tree
+// changes before the commit. "" on failure.
+template <class Policy>
+std::string BasicMiniGit<Policy>::store_large_file(const std::string& filename, std::uintmax_t size) {
+    std::error_code ec;
+    std::filesystem::create_directories(large_path, ec);
+    std::string temp = utils::temp_path(large_path + "/incoming");
+    std::string hash = utils::hash_copy_file(Policy::algorithm(), filename, temp, utils::object_header("blob", size));
+    // A file that changed size while being read was hashed with the wrong header
+    if (hash.empty() || utils::file_size(temp) != size || !utils::rename_file(temp, large_path + "/" + hash)) {
+        std::filesystem::remove(temp, ec);
+        return "";
+    }
+    return hash;
+}
+
+template <class Policy>
+std::shared_ptr<Blob> BasicMiniGit<Policy>::load_blob(const std::string& hash) {
+    std::string blob_data = read_object(hash);
+    if (blob_data.empty()) {
+        return nullptr;
+    }
+    return Blob::from_string(blob_data, hash);
+}
+
+// Files at or above core.bigFileThreshold (default 512m) bypass the object
+// format and are stored whole in .minigit/large.
+template <class Policy>
+std::uintmax_t BasicMiniGit<Policy>::large_file_threshold() const {
+    return static_cast<std::uintmax_t>(config.get_int("core.bigFileThreshold", 512LL << 20));
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::read_large_range(const std::string& hash, std::uintmax_t offset, size_t length) const {
+    return utils::read_file_range(large_path + "/" + hash, offset, length);
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::save_commit(const std::shared_ptr<Commit>& commit) {
+    if (has_object(commit->get_hash())) {
+        return true;
+    }
+    std::string commit_path = objects_path + "/" + commit->get_hash();
+    if (!utils::write_file_atomic(commit_path, encode_object(commit->to_string()))) {
+        utils::print_error("Failed to write commit " + commit->get_hash());
+        return false;
+    }
+    return true;
+}
+
+template <class Policy>
+std::shared_ptr<Commit> BasicMiniGit<Policy>::load_commit(const std::string& hash) {
+    std::string commit_data = read_object(hash);
+    if (commit_data.empty()) {
+        return nullptr;
+    }
+    return Commit::from_string(commit_data);
+}
+
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::list_loose_objects() const {
+    std::vector<std::string> loose;
+    for (const auto& name : utils::list_files(objects_path)) {
+        if (is_object_id(name)) {
+            loose.push_back(name);
+        }
+    }
+    return loose;
+}
+
+template <class Policy>
+void BasicMiniGit<Policy>::save_head(const std::string& commit_hash) {
+    utils::write_file(head_path, commit_hash);
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::load_head() const {
+    return utils::read_file(head_path);
+}
+
+template <class Policy>
+void BasicMiniGit<Policy>::save_branch(const std::shared_ptr<Branch>& branch) {
+    std::string branch_path = refs_path + "/" + branch->get_name();
+    utils::write_file(branch_path, branch->to_string());
+}
+
+template <class Policy>
+std::shared_ptr<Branch> BasicMiniGit<Policy>::load_branch(const std::string& name) {
+    std::string branch_path = refs_path + "/" + name;
+    std::string branch_data = utils::read_file(branch_path);
+    if (branch_data.empty()) {
+        return nullptr;
+    }
+    return Branch::from_string(branch_data);
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::add(const std::string& filename) {
+    return add(std::vector<std::string>{filename});
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::add(const std::vector<std::string>& filenames) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    for (const auto& filename : filenames) {
+        if (!utils::file_exists(filename)) {
+            utils::print_error("File '" + filename + "' does not exist");
+            return false;
+        }
+    }
+    
+    // Read files concurrently, a group at a time so their contents are
+    // hashed together (by sha1_multi, for SHA-1); stage them in argument
+    // order
+    std::vector<std::shared_ptr<Blob>> blobs(filenames.size());
+    std::uintmax_t threshold = large_file_threshold();
+    std::vector<char> failed(filenames.size(), 0); // large files that could not be stored
+    size_t group_size = std::is_same_v<Policy, Sha1Policy> ? sha1_multi::lanes() : 1;
+    size_t groups = (filenames.size() + group_size - 1) / group_size;
+    Executor& executor = Executor::shared();
+    bool completed = for_each_bounded(executor, groups, 2 * executor.size(), [&](size_t group) -> Task<> {
+        size_t begin = group * group_size;
+        size_t end = std::min(filenames.size(), begin + group_size);
+        std::vector<std::string> contents(end - begin);
+        std::vector<std::string_view> inputs;
+        for (size_t i = begin; i < end; ++i) {
+            const std::string& filename = filenames[i];
+            std::uintmax_t size = utils::file_size(filename);
+            if (size >= threshold) {
+                std::string hash = store_large_file(filename, size);
+                if (hash.empty()) {
+                    failed[i] = 1;
+                } else {
+                    blobs[i] = Blob::large_file(hash, size, filename);
+                }
+            } else {
+                contents[i - begin] = utils::read_file(filename);
+                inputs.push_back(contents[i - begin]);
+            }
+        }
+        std::vector<std::string> hashes = hash_objects("blob", inputs);
+        for (size_t i = begin, k = 0; i < end; ++i) {
+            if (!blobs[i] && !failed[i]) {
+                blobs[i] = std::make_shared<Blob>(std::move(contents[i - begin]), filenames[i], hashes[k++]);
+            }
+        }
+        co_return;
+    }, cancellation.get_token());
+    if (!completed) {
+        utils::print_error("Add cancelled");
+        return false;
+    }
+    bool stored = true;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (failed[i]) {
+            utils::print_error("Failed to store large file '" + filenames[i] + "'");
+            stored = false;
+        }
+    }
+    if (!stored) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        staging_area[filenames[i]] = blobs[i];
+        utils::print_success("Added '" + filenames[i] + "' to staging area");
+    }
+    return true;
+}
+
+// Stores blobs as loose objects through three stages joined by bounded
+// channels: prepare (existence check and serialization), compress, and
+// write (batches of core.ioQueueDepth handed to the I/O engine). Each
+// stage has its own coroutines, so while one batch is being written the
+// next files are already being serialized and compressed.
+template <class Policy>
+bool BasicMiniGit<Policy>::write_objects(const std::vector<std::shared_ptr<Blob>>& blobs) {
+    Executor& executor = Executor::shared();
+    size_t width = std::max(1u, executor.size());
+    size_t batch_size = io_queue_depth();
+    int level = compression_level();
+    std::stop_token stop = cancellation.get_token();
+    
+    Channel<IoRequest> to_compress(executor, 2 * width);
+    Channel<IoRequest> to_write(executor, 2 * batch_size);
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> preparers_left{width};
+    std::atomic<size_t> compressors_left{width};
+    std::atomic<bool> cancelled{false};
+    std::vector<std::string> failed;
+    
+    auto prepare = [&]() -> Task<> {
+        co_await executor.schedule();
+        for (size_t i = next++; i < blobs.size(); i = next++) {
+            if (stop.stop_requested()) {
+                cancelled = true;
+                break;
+            }
+            const auto& blob = blobs[i];
+            if (!has_object(blob->get_hash())) {
+                IoRequest request{objects_path + "/" + blob->get_hash(), blob->to_string()};
+                co_await to_compress.push(request);
+            }
+        }
+        if (--preparers_left == 0) {
+            to_compress.close();
+        }
+    };
+    
+    auto compress = [&]() -> Task<> {
+        co_await executor.schedule();
+        IoRequest request;
+        while (co_await to_compress.pop(request)) {
+            if (level > 0) {
+                request.data = utils::compress(request.data, level);
+            }
+            co_await to_write.push(request);
+        }
+        if (--compressors_left == 0) {
+            to_write.close();
+        }
+    };
+    
+    auto write = [&]() -> Task<> {
+        co_await executor.schedule();
+        std::vector<IoRequest> batch;
+        // Each object is written under a temporary name and renamed onto
+        // its id once complete
+        std::vector<std::string> targets;
+        auto flush = [&]() {
+            targets.clear();
+            for (auto& request : batch) {
+                targets.push_back(request.path);
+                request.path = utils::temp_path(request.path);
+            }
+            io_engine().write_files(batch);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (!batch[i].ok) {
+                    std::error_code ec;
+                    std::filesystem::remove(batch[i].path, ec);
+                    failed.push_back(targets[i]);
+                } else if (!utils::rename_file(batch[i].path, targets[i])) {
+                    failed.push_back(targets[i]);
+                }
+            }
+            batch.clear();
+        };
+        IoRequest request;
+        while (co_await to_write.pop(request)) {
+            batch.push_back(std::move(request));
+            if (batch.size() >= batch_size) {
+                flush();
+            }
+        }
+        flush();
+    };
+    
+    std::vector<Task<>> tasks;
+    for (size_t i = 0; i < width; ++i) {
+        tasks.push_back(prepare());
+        tasks.push_back(compress());
+    }
+    tasks.push_back(write());
+    sync_wait_all(std::move(tasks));
+    
+    if (cancelled) {
+        utils::print_error("Commit cancelled");
+        return false;
+    }
+    for (const auto& path : failed) {
+        utils::print_error("Failed to write object " + path);
+    }
+    return failed.empty();
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::commit(const std::string& message) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    if (staging_area.empty()) {
+        utils::print_error("No changes staged for commit");
+        return false;
+    }
+    
+    // Create commit
+    auto commit = std::make_shared<Commit>(message);
+    
+    // Add parent commit if exists
+    std::string head_commit = load_head();
+    if (!head_commit.empty()) {
+        commit->add_parent(head_commit);
+    }
+    
+    // Add staged files, collecting the objects that still need storing
+    std::vector<std::shared_ptr<Blob>> pending;
+    std::set<std::string> queued;
+    for (const auto& [filename, blob] : staging_area) {
+        if (blob->is_large()) {
+            if (!save_blob(blob)) {
+                return false;
+            }
+        } else if (queued.insert(blob->get_hash()).second) {
+            pending.push_back(blob);
+        }
+        commit->add_file(filename, blob->get_hash());
+    }
+    
+    if (!write_objects(pending)) {
+        return false;
+    }
+    
+    // Save commit under its content-derived id
+    commit->set_hash(commit->compute_hash<Policy>());
+    if (!save_commit(commit)) {
+        return false;
+    }
+    
+    // Update HEAD and current branch
+    save_head(commit->get_hash());
+    if (branches.find(current_branch) != branches.end()) {
+        branches[current_branch]->set_commit_hash(commit->get_hash());
+        save_branch(branches[current_branch]);
+    }
+    
+    // Clear staging area
+    staging_area.clear();
+    
+    if (config.get_bool("commitGraph.writeOnCommit", true)) {
+        update_commit_graph();
+    }
+    
+    utils::print_success("Committed " + std::to_string(commit->get_files().size()) + " files");
+    utils::print_info("Commit: " + commit->get_hash().substr(0, 8));
+    
+    maybe_run_maintenance();
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::log() {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    std::string current_commit_hash = load_head();
+    if (current_commit_hash.empty()) {
+        utils::print_info("No commits yet");
+        return true;
+    }
+    
+    std::string commit_hash = current_commit_hash;
+    int commit_count = 0;
+    
+    while (!commit_hash.empty()) {
+        auto commit = load_commit(commit_hash);
+        if (!commit) {
+            break;
+        }
+        
+        std::cout << "\ncommit " << commit->get_hash() << std::endl;
+        std::cout << "Author: " << commit->get_author() << std::endl;
+        std::cout << "Date:   " << utils::timestamp_to_string(commit->get_timestamp()) << std::endl;
+        std::cout << std::endl;
+        std::cout << "    " << commit->get_message() << std::endl;
+        
+        if (commit->is_initial_commit()) {
+            break;
+        }
+        
+        commit_hash = commit->get_parents().empty() ? "" : commit->get_parents()[0];
+        commit_count++;
+        
+        if (commit_count > 100) { // Prevent infinite loops
+            break;
+        }
+    }
+    
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::branch(const std::string& branch_name) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    if (branches.find(branch_name) != branches.end()) {
+        utils::print_error("Branch '" + branch_name + "' already exists");
+        return false;
+    }
+    
+    std::string current_commit = load_head();
+    auto new_branch = std::make_shared<Branch>(branch_name, current_commit);
+    branches[branch_name] = new_branch;
+    save_branch(new_branch);
+    
+    utils::print_success("Created branch '" + branch_name + "'");
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::checkout(const std::string& target) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    // Check if target is a branch
+    if (branches.find(target) != branches.end()) {
+        current_branch = target;
+        std::string commit_hash = branches[target]->get_commit_hash();
+        if (!commit_hash.empty()) {
+            save_head(commit_hash);
+        }
+        utils::print_success("Switched to branch '" + target + "'");
+        return true;
+    }
+    
+    // Check if target is a commit hash
+    auto commit = load_commit(target);
+    if (commit) {
+        save_head(target);
+        utils::print_success("Switched to commit " + target.substr(0, 8));
+        return true;
+    }
+    
+    utils::print_error("Target '" + target + "' not found");
+    return false;
+}
+
+// Follows first parents. Commits covered by the commit-graph are walked
+// there without loading their objects. Generations fall strictly along
+// parents, so a parent that is past the graph or not lower than its child
+// means the graph is damaged and the rest is walked through the objects.
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::get_commit_ancestors(const std::string& commit_hash) {
+    std::vector<std::string> ancestors;
+    std::string current = commit_hash;
+    const CommitGraphChain& graph = commit_graph();
+    bool use_graph = true;
+    
+    while (!current.empty()) {
+        std::uint32_t position = 0;
+        if (use_graph && graph.find(current, position)) {
+            while (true) {
+                std::vector<std::uint32_t> parents = graph.parents(position);
+                if (parents.empty()) {
+                    ancestors.push_back(graph.hash_at(position));
+                    return ancestors;
+                }
+                if (parents[0] >= graph.size() || graph.generation(parents[0]) >= graph.generation(position)) {
+                    current = graph.hash_at(position);
+                    use_graph = false;
+                    break;
+                }
+                ancestors.push_back(graph.hash_at(position));
+                position = parents[0];
+            }
+        }
+        
+        auto commit = load_commit(current);
+        if (!commit) {
+            break;
+        }
+        
+        ancestors.push_back(current);
+        
+        if (commit->is_initial_commit()) {
+            break;
+        }
+        
+        current = commit->get_parents().empty() ? "" : commit->get_parents()[0];
+    }
+    
+    return ancestors;
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::find_lowest_common_ancestor(const std::string& commit1_hash, const std::string& commit2_hash) {
+    auto ancestors1 = get_commit_ancestors(commit1_hash);
+    auto ancestors2 = get_commit_ancestors(commit2_hash);
+    
+    std::set<std::string> set1(ancestors1.begin(), ancestors1.end());
+    
+    for (const auto& ancestor : ancestors2) {
+        if (set1.find(ancestor) != set1.end()) {
+            return ancestor;
+        }
+    }
+    
+    return "";
+}
+
+template <class Policy>
+std::map<std::string, std::string> BasicMiniGit<Policy>::get_file_changes(const std::string& from_hash, const std::string& to_hash) {
+    std::map<std::string, std::string> changes;
+    
+    auto from_commit = load_commit(from_hash);
+    auto to_commit = load_commit(to_hash);
+    
+    if (!from_commit || !to_commit) {
+        return changes;
+    }
+    
+    auto from_files = from_commit->get_files();
+    auto to_files = to_commit->get_files();
+    
+    // Find changed files
+    for (const auto& [filename, blob_hash] : to_files) {
+        auto it = from_files.find(filename);
+        if (it == from_files.end() || it->second != blob_hash) {
+            changes[filename] = blob_hash;
+        }
+    }
+    
+    return changes;
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::merge_files(const std::string& base_content, const std::string& ours_content, const std::string& theirs_content) {
+    if (ours_content == theirs_content) {
+        return ours_content;
+    }
+    
+    if (base_content == ours_content) {
+        return theirs_content;
+    }
+    
+    if (base_content == theirs_content) {
+        return ours_content;
+    }
+    
+    // Simple merge strategy: append conflict markers
+    std::string merged = base_content;
+    merged += "\n<<<<<<< HEAD\n";
+    merged += ours_content;
+    merged += "\n=======\n";
+    merged += theirs_content;
+    merged += "\n>>>>>>> MERGE\n";
+    
+    return merged;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::merge(const std::string& branch_name) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    if (branches.find(branch_name) == branches.end()) {
+        utils::print_error("Branch '" + branch_name + "' does not exist");
+        return false;
+    }
+    
+    std::string current_commit = load_head();
+    std::string target_commit = branches[branch_name]->get_commit_hash();
+    
+    if (current_commit == target_commit) {
+        utils::print_info("Already up to date");
+        return true;
+    }
+    
+    // Find lowest common ancestor
+    std::string lca = find_lowest_common_ancestor(current_commit, target_commit);
+    if (lca.empty()) {
+        utils::print_error("No common ancestor found");
+        return false;
+    }
+    
+    // Get changes from LCA to current and target
+    auto current_changes = get_file_changes(lca, current_commit);
+    auto target_changes = get_file_changes(lca, target_commit);
+    
+    bool has_conflicts = false;
+    std::map<std::string, std::string> merged_files;
+    
+    // Merge files
+    for (const auto& [filename, blob_hash] : target_changes) {
+        auto current_it = current_changes.find(filename);
+        
+        if (current_it == current_changes.end()) {
+            // File only changed in target branch
+            merged_files[filename] = blob_hash;
+        } else if (current_it->second == blob_hash) {
+            // Same change in both branches
+            merged_files[filename] = blob_hash;
+        } else {
+            // Conflict - both branches modified the file
+            has_conflicts = true;
+            utils::print_warning("CONFLICT: both modified " + filename);
+            
+            // Large files are never merged by content; keep our version.
+            // Checked from the object headers, before loading anything.
+            ObjectInfo ours_info;
+            ObjectInfo theirs_info;
+            if (object_info(current_it->second, ours_info) && object_info(blob_hash, theirs_info) &&
+                (ours_info.type == ObjectType::Large || theirs_info.type == ObjectType::Large)) {
+                utils::print_warning("Large file " + filename + " kept at our version");
+                merged_files[filename] = current_it->second;
+                continue;
+            }
+            
+            // Load the three versions
+            auto base_blob = load_blob(load_commit(lca)->get_files().at(filename));
+            auto ours_blob = load_blob(current_it->second);
+            auto theirs_blob = load_blob(blob_hash);
+            
+            if (base_blob && ours_blob && theirs_blob) {
+                std::string merged_content = merge_files(
+                    base_blob->get_content(),
+                    ours_blob->get_content(),
+                    theirs_blob->get_content()
+                );
+                
+                auto merged_blob = Blob::create<Policy>(merged_content, filename);
+                if (!save_blob(merged_blob)) {
+                    return false;
+                }
+                merged_files[filename] = merged_blob->get_hash();
+            }
+        }
+    }
+    
+    // Add files that only changed in current branch
+    for (const auto& [filename, blob_hash] : current_changes) {
+        if (target_changes.find(filename) == target_changes.end()) {
+            merged_files[filename] = blob_hash;
+        }
+    }
+    
+    // Create merge commit
+    std::string merge_message = "Merge branch '" + branch_name + "' into " + current_branch;
+    auto merge_commit = std::make_shared<Commit>(merge_message);
+    merge_commit->add_parent(current_commit);
+    merge_commit->add_parent(target_commit);
+    
+    // Add all merged files
+    for (const auto& [filename, blob_hash] : merged_files) {
+        merge_commit->add_file(filename, blob_hash);
+    }
+    
+    // Save merge commit
+    merge_commit->set_hash(merge_commit->compute_hash<Policy>());
+    if (!save_commit(merge_commit)) {
+        return false;
+    }
+    save_head(merge_commit->get_hash());
+    
+    // Update current branch
+    if (branches.find(current_branch) != branches.end()) {
+        branches[current_branch]->set_commit_hash(merge_commit->get_hash());
+        save_branch(branches[current_branch]);
+    }
+    
+    if (config.get_bool("commitGraph.writeOnCommit", true)) {
+        update_commit_graph();
+    }
+    
+    if (has_conflicts) {
+        utils::print_warning("Merge completed with conflicts");
+    } else {
+        utils::print_success("Merge completed successfully");
+    }
+    
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::diff(const std::string& commit1, const std::string& commit2) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    auto commit1_obj = load_commit(commit1);
+    auto commit2_obj = load_commit(commit2);
+    
+    if (!commit1_obj || !commit2_obj) {
+        utils::print_error("Invalid commit hash");
+        return false;
+    }
+    
+    auto files1 = commit1_obj->get_files();
+    auto files2 = commit2_obj->get_files();
+    
+    std::set<std::string> all_files;
+    for (const auto& [filename, _] : files1) {
+        all_files.insert(filename);
+    }
+    for (const auto& [filename, _] : files2) {
+        all_files.insert(filename);
+    }
+    
+    // Fetch every blob that differs in one batched read
+    std::vector<std::string> changed;
+    std::vector<std::string> wanted;
+    for (const auto& filename : all_files) {
+        auto it1 = files1.find(filename);
+        auto it2 = files2.find(filename);
+        if (it1 != files1.end() && it2 != files2.end() && it1->second == it2->second) {
+            continue;
+        }
+        changed.push_back(filename);
+        if (it1 != files1.end()) wanted.push_back(it1->second);
+        if (it2 != files2.end()) wanted.push_back(it2->second);
+    }
+    
+    std::map<std::string, std::shared_ptr<Blob>> blobs;
+    load_objects(wanted, [&blobs](const std::string& hash, const std::string& data) {
+        auto blob = data.empty() ? nullptr : Blob::from_string(data, hash);
+        if (blob) {
+            blobs[hash] = blob;
+        }
+    });
+    auto find_blob = [&blobs](const std::string& hash) -> std::shared_ptr<Blob> {
+        auto it = blobs.find(hash);
+        return it == blobs.end() ? nullptr : it->second;
+    };
+    
+    // Files are diffed concurrently and printed in order afterwards
+    std::vector<std::string> output(changed.size());
+    Executor& executor = Executor::shared();
+    bool completed = for_each_bounded(executor, changed.size(), 2 * executor.size(), [&](size_t i) -> Task<> {
+        const std::string& filename = changed[i];
+        auto it1 = files1.find(filename);
+        auto it2 = files2.find(filename);
+        std::ostringstream out;
+        
+        // Large files are compared by hash and size only; their content is
+        // never read
+        auto blob1 = it1 == files1.end() ? nullptr : find_blob(it1->second);
+        auto blob2 = it2 == files2.end() ? nullptr : find_blob(it2->second);
+        if ((blob1 && blob1->is_large()) || (blob2 && blob2->is_large())) {
+            out << "diff --git a/" << filename << " b/" << filename << "\n";
+            out << "Large file ";
+            if (blob1) {
+                out << it1->second.substr(0, 8) << " (" << blob1->size() << " bytes)";
+            } else {
+                out << "/dev/null";
+            }
+            out << " -> ";
+            if (blob2) {
+                out << it2->second.substr(0, 8) << " (" << blob2->size() << " bytes)";
+            } else {
+                out << "/dev/null";
+            }
+            out << "\n";
+        } else if (it1 == files1.end()) {
+            // File added in commit2
+            if (blob2) {
+                out << "diff --git a/" << filename << " b/" << filename << "\n";
+                out << "new file mode 100644" << "\n";
+                out << "--- /dev/null" << "\n";
+                out << "+++ b/" << filename << "\n";
+                
+                auto lines = utils::split(blob2->get_content(), '\n');
+                for (const auto& line : lines) {
+                    out << "+" << line << "\n";
+                }
+            }
+        } else if (it2 == files2.end()) {
+            // File deleted in commit2
+            if (blob1) {
+                out << "diff --git a/" << filename << " b/" << filename << "\n";
+                out << "deleted file mode 100644" << "\n";
+                out << "--- a/" << filename << "\n";
+                out << "+++ /dev/null" << "\n";
+                
+                auto lines = utils::split(blob1->get_content(), '\n');
+                for (const auto& line : lines) {
+                    out << "-" << line << "\n";
+                }
+            }
+        } else {
+            // File modified
+            if (blob1 && blob2) {
+                out << "diff --git a/" << filename << " b/" << filename << "\n";
+                out << "--- a/" << filename << "\n";
+                out << "+++ b/" << filename << "\n";
+                
+                auto diff_lines = utils::compute_diff(blob1->get_content(), blob2->get_content());
+                for (const auto& line : diff_lines) {
+                    out << line << "\n";
+                }
+            }
+        }
+        
+        output[i] = out.str();
+        co_return;
+    }, cancellation.get_token());
+    if (!completed) {
+        return false;
+    }
+    
+    for (const auto& text : output) {
+        std::cout << text;
+    }
+    std::cout.flush();
+    
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::config_value(const std::string& key, const std::string& value) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    if (value.empty()) {
+        if (!config.has(key)) {
+            return false;
+        }
+        std::cout << config.get(key) << std::endl;
+        return true;
+    }
+    
+    if (key == "extensions.objectFormat") {
+        utils::print_error("The object format is fixed when a repository is created");
+        return false;
+    }
+    
+    config.set(key, value);
+    return config.save();
+}
+
+// Moves every loose object into one new pack, then updates the
+// multi-pack-index so a lookup stays a single binary search however many
+// packs accumulate. Loose copies are deleted only once the pack is in place.
+//
+// With a geometric factor, the smallest packs are folded into the new pack
+// as well, just enough that pack sizes form a geometric progression. The
+// large packs at the top are never rewritten, so each run touches a small
+// share of the data while the number of packs stays logarithmic in the
+// object count.
+template <class Policy>
+bool BasicMiniGit<Policy>::repack(unsigned geometric_factor) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    std::vector<std::string> loose = list_loose_objects();
+    
+    std::vector<const Pack*> rollup;
+    if (geometric_factor > 1) {
+        rollup = packs().geometric_rollup(geometric_factor, loose.size());
+    }
+    if (loose.empty() && rollup.size() < 2) {
+        utils::print_info("Nothing to repack");
+        return true;
+    }
+    
+    // First pass: what the delta search sorts by. Blob paths come from the
+    // commits being packed; blobs only reachable through older commits
+    // sort by size alone.
+    bool ok = true;
+    std::vector<typename PackBuilder::Object> objects;
+    std::set<std::string> written;
+    std::map<std::string, std::string> blob_paths;
+    auto note = [&](const std::string& hash, const std::string& data) {
+        if (data.empty()) {
+            utils::print_error("Failed to read object " + hash);
+            ok = false;
+            return;
+        }
+        if (!written.insert(hash).second) {
+            return;
+        }
+        ObjectType type = object_type_of(data);
+        objects.push_back({hash, type, data.size(), 0});
+        if (type == ObjectType::Commit) {
+            if (auto commit = Commit::from_string(data)) {
+                for (const auto& [filename, blob] : commit->get_files()) {
+                    blob_paths.emplace(blob, filename);
+                }
+            }
+        }
+    };
+    load_objects(loose, note);
+    
+    std::set<std::string> merged;
+    for (const Pack* pack : rollup) {
+        // In pack order so the old pack is read sequentially
+        const PackIndex& index = pack->get_index();
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> order;
+        for (std::uint32_t i = 0; i < index.size(); ++i) {
+            order.emplace_back(index.offset_at(i), i);
+        }
+        std::sort(order.begin(), order.end());
+        for (const auto& [offset, i] : order) {
+            note(utils::hex_encode(index.id_at(i), Policy::DIGEST_SIZE), pack->read(offset));
+        }
+        merged.insert(pack->get_name());
+    }
+    if (!ok) {
+        utils::print_error("Repack failed");
+        return false;
+    }
+    
+    // Second pass: pack.window, pack.depth and pack.windowMemory (per
+    // search thread) bound the delta search; pack.dictionary enables a
+    // dictionary for objects up to pack.dictionaryThreshold. See PackBuilder.
+    typename PackBuilder::Options options;
+    options.level = static_cast<int>(config.get_int("pack.compression", 6));
+    options.window = static_cast<unsigned>(std::max<std::int64_t>(0, config.get_int("pack.window", 10)));
+    options.depth = static_cast<unsigned>(std::max<std::int64_t>(1, config.get_int("pack.depth", 50)));
+    options.window_memory = static_cast<size_t>(std::max<std::int64_t>(0, config.get_int("pack.windowMemory", 256LL << 20)));
+    if (config.get_bool("pack.dictionary", false)) {
+        options.dictionary_threshold = static_cast<size_t>(std::max<std::int64_t>(0, config.get_int("pack.dictionaryThreshold", 1024)));
+    }
+    PackBuilder builder(pack_path, options);
+    for (auto& object : objects) {
+        auto path = blob_paths.find(object.hash);
+        if (path != blob_paths.end()) {
+            object.path_hash = PackBuilder::path_hash(path->second);
+        }
+        builder.add(std::move(object));
+    }
+    
+    // Entries that get no new delta are copied from the old pack without
+    // being inflated; old deltas are rebuilt, as their bases may not be
+    // written ahead of them
+    std::string name = builder.write(
+        [this](const std::string& hash) { return read_object(hash); },
+        [this](const std::string& hash, std::string& entry) {
+            PackLocation location;
+            return packs().find(hash, location) && location.pack->copy_raw(location.offset, entry);
+        });
+    if (!ok || name.empty()) {
+        utils::print_error("Repack failed");
+        return false;
+    }
+    merged.erase(name);
+    
+    packs().load();
+    if (!packs().write_multi_pack_index(merged)) {
+        utils::print_warning("Failed to write multi-pack-index");
+    }
+    packs().remove_packs(merged);
+    
+    for (const auto& hash : loose) {
+        if (packs().has(hash)) {
+            std::error_code ec;
+            std::filesystem::remove(objects_path + "/" + hash, ec);
+        }
+    }
+    
+    std::string summary = "Packed " + std::to_string(builder.count()) + " objects (" +
+                          std::to_string(builder.delta_count()) + " deltas) into " + name;
+    if (!merged.empty()) {
+        summary += " (merged " + std::to_string(merged.size()) + " packs)";
+    }
+    utils::print_success(summary);
+    return true;
+}
+
+template <class Policy>
+bool BasicMiniGit<Policy>::cat_file(const std::string& option, const std::string& hash) {
+    if (!is_initialized) {
+        utils::print_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    ObjectInfo info;
+    if (!is_object_id(hash) || !object_info(hash, info)) {
+        utils::print_error("Object not found: " + hash);
+        return false;
+    }
+    if (option == "-t") {
+        std::cout << object_type_name(info.type) << std::endl;
+        return true;
+    }
+    if (option == "-s") {
+        std::cout << info.size << std::endl;
+        return true;
+    }
+    if (option != "-p") {
+        utils::print_error("Unknown option: " + option);
+        return false;
+    }
+    
+    // Large content is streamed from the large-object store
+    if (info.type == ObjectType::Large) {
+        const size_t CHUNK = 1 << 20;
+        for (std::uintmax_t offset = 0; offset < info.size; offset += CHUNK) {
+            std::string chunk = read_large_range(hash, offset, CHUNK);
+            if (chunk.empty()) {
+                utils::print_error("Failed to read large file " + hash);
+                return false;
+            }
+            std::cout << chunk;
+        }
+        return true;
+    }
+    std::string data = read_object(hash);
+    auto blob = info.type == ObjectType::Blob ? Blob::from_string(data, hash) : nullptr;
+    std::cout << (blob ? blob->get_content() : data);
+    return true;
+}
+
+// Requests are taken in batches: after each blocking read of an id, the
+// ids already waiting in the input join it, up to MAX_BATCH. A client
+// piping thousands of ids gets them loaded in one sorted pass, while one
+// asking for a single id and waiting for the answer is not held up. Pack
+// windows and the delta base cache stay warm across batches.
+template <class Policy>
+bool BasicMiniGit<Policy>::cat_file_batch(bool contents, std::istream& in, std::ostream& out) {
+    if (!is_initialized) {
+        utils::report_error("Not a MiniGit repository");
+        return false;
+    }
+    
+    const size_t MAX_BATCH = 1024;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> batch{utils::trim(line)};
+        while (batch.size() < MAX_BATCH && in.rdbuf()->in_avail() > 0 && std::getline(in, line)) {
+            batch.push_back(utils::trim(line));
+        }
+        
+        std::map<std::string, std::string> loaded;
+        std::map<std::string, ObjectInfo> infos;
+        std::vector<std::string> wanted;
+        for (const auto& hash : batch) {
+            if (is_object_id(hash)) {
+                wanted.push_back(hash);
+            }
+        }
+        if (contents) {
+            load_objects(wanted, [&](const std::string& hash, const std::string& data) {
+                ObjectInfo info;
+                if (!data.empty() && object_info_of(data, data.size(), info)) {
+                    infos[hash] = info;
+                    loaded[hash] = data;
+                }
+            });
+        } else {
+            for (const auto& hash : wanted) {
+                ObjectInfo info;
+                if (object_info(hash, info)) {
+                    infos[hash] = info;
+                }
+            }
+        }
+        
+        // The header promises exactly `size` bytes, so content that cannot
+        // be produced in full is reported missing before anything is
+        // written. Large files are opened first and streamed from the open
+        // file.
+        for (const auto& hash : batch) {
+            auto info = infos.find(hash);
+            std::string content;
+            std::ifstream large;
+            bool found = info != infos.end();
+            if (found && contents) {
+                const std::string& data = loaded[hash];
+                if (info->second.type == ObjectType::Large) {
+                    std::string path = large_path + "/" + hash;
+                    large.open(path, std::ios::binary);
+                    found = large.is_open() && utils::file_size(path) == info->second.size;
+                } else if (info->second.type == ObjectType::Blob) {
+                    auto blob = Blob::from_string(data, hash);
+                    found = blob != nullptr;
+                    content = found ? blob->get_content() : "";
+                } else {
+                    content = data;
+                }
+            }
+            if (!found) {
+                out << hash << " missing\n";
+                continue;
+            }
+            out << hash << ' ' << object_type_name(info->second.type) << ' ' << info->second.size << '\n';
+            if (!contents) {
+                continue;
+            }
+            if (large.is_open()) {
+                std::vector<char> chunk(1 << 20);
+                while (large.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || large.gcount() > 0) {
+                    out.write(chunk.data(), large.gcount());
+                }
+            } else {
+                out << content;
+            }
+            out << '\n';
+        }
+        out.flush();
+    }
+    return true;
+}
+
+template <class Policy>
+std::vector<std::string> BasicMiniGit<Policy>::get_branches() const {
+    std::vector<std::string> branch_names;
+    for (const auto& [name, _] : branches) {
+        branch_names.push_back(name);
+    }
+    return branch_names;
+}
+
+template <class Policy>
+std::string BasicMiniGit<Policy>::get_head_commit() const {
+    return load_head();
+} 
+
+template class BasicMiniGit<Sha1Policy>;
+template class BasicMiniGit<Sha256Policy>;
+
+bool read_object_format(const std::string& path, ObjectFormat& format) {
+    Config config(path + "/.minigit/config");
+    config.load();
+    std::string name = config.get("extensions.objectFormat", Sha1Policy::NAME);
+    if (!parse_object_format(name, format)) {
+        utils::print_error("Unknown object format '" + name + "'");
+        return false;
+    }
+    return true;
+}
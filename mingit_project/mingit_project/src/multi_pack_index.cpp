@@ -0,0 +1,252 @@
+#include "multi_pack_index.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <queue>
+
+namespace {
+
+const char MIDX_MAGIC[4] = {'M', 'G', 'M', 'I'};
+const std::uint32_t MIDX_VERSION = 1;
+const size_t FANOUT_SIZE = 256 * 4;
+const size_t LOCATION_SIZE = 12;
+
+} // namespace
+
+template <class Policy>
+bool BasicMultiPackIndex<Policy>::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    const unsigned char* p = file.data();
+    const unsigned char* end = p + file.size();
+    if (file.size() < 12 + FANOUT_SIZE + ID_SIZE ||
+        std::memcmp(p, MIDX_MAGIC, 4) != 0 || utils::get_be32(p + 4) != MIDX_VERSION) {
+        close();
+        return false;
+    }
+
+    // Checked like the commit-graph's, so a damaged file is not trusted
+    unsigned char digest[ID_SIZE];
+    HashContext<Policy>::digest(p, file.size() - ID_SIZE, digest);
+    if (std::memcmp(digest, end - ID_SIZE, ID_SIZE) != 0) {
+        close();
+        return false;
+    }
+
+    std::uint32_t pack_count = utils::get_be32(p + 8);
+    p += 12;
+    for (std::uint32_t i = 0; i < pack_count; ++i) {
+        if (end - p < 2) {
+            close();
+            return false;
+        }
+        size_t length = (static_cast<size_t>(p[0]) << 8) | p[1];
+        p += 2;
+        if (static_cast<size_t>(end - p) < length) {
+            close();
+            return false;
+        }
+        pack_names.emplace_back(reinterpret_cast<const char*>(p), length);
+        p += length;
+    }
+
+    if (static_cast<size_t>(end - p) < FANOUT_SIZE + ID_SIZE) {
+        close();
+        return false;
+    }
+    // find() trusts both the count and the fan-out, as in PackIndex
+    fanout = p;
+    count = utils::get_be32(fanout + 255 * 4);
+    size_t remaining = static_cast<size_t>(end - p) - FANOUT_SIZE - ID_SIZE;
+    if (remaining != static_cast<size_t>(count) * (ID_SIZE + LOCATION_SIZE) || !fanout_is_sorted(fanout)) {
+        close();
+        return false;
+    }
+    ids = fanout + FANOUT_SIZE;
+    locations = ids + static_cast<size_t>(count) * ID_SIZE;
+    return true;
+}
+
+template <class Policy>
+void BasicMultiPackIndex<Policy>::close() {
+    file.close();
+    pack_names.clear();
+    fanout = ids = locations = nullptr;
+    count = 0;
+}
+
+template <class Policy>
+bool BasicMultiPackIndex<Policy>::find(const unsigned char* id, std::uint32_t& pack, std::uint64_t& offset) const {
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::uint32_t low = id[0] == 0 ? 0 : utils::get_be32(fanout + (id[0] - 1) * 4);
+    std::uint32_t high = utils::get_be32(fanout + id[0] * 4);
+    while (low < high) {
+        std::uint32_t mid = low + (high - low) / 2;
+        int cmp = std::memcmp(ids + static_cast<size_t>(mid) * ID_SIZE, id, ID_SIZE);
+        if (cmp == 0) {
+            const unsigned char* location = locations + static_cast<size_t>(mid) * LOCATION_SIZE;
+            pack = utils::get_be32(location);
+            offset = utils::get_be64(location + 4);
+            return pack < pack_names.size();
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+template <class Policy>
+std::uint32_t BasicMultiPackIndex<Policy>::pack_at(std::uint32_t i) const {
+    return utils::get_be32(locations + static_cast<size_t>(i) * LOCATION_SIZE);
+}
+
+template <class Policy>
+std::uint64_t BasicMultiPackIndex<Policy>::offset_at(std::uint32_t i) const {
+    return utils::get_be64(locations + static_cast<size_t>(i) * LOCATION_SIZE + 4);
+}
+
+template <class Policy>
+bool BasicMultiPackIndex<Policy>::write(const std::string& path, const std::vector<const Pack*>& packs,
+                                        const BasicMultiPackIndex* base) {
+    struct Entry {
+        const unsigned char* id;
+        std::uint32_t pack;
+        std::uint64_t offset;
+    };
+    // One sorted source: either a pack's own index or the reusable part of
+    // the base midx
+    struct Run {
+        const PackIndex* index = nullptr;
+        std::uint32_t pack = 0;
+        std::uint32_t position = 0;
+        std::uint32_t end = 0;
+    };
+
+    std::vector<const Pack*> ordered = packs;
+    std::sort(ordered.begin(), ordered.end(),
+              [](const Pack* a, const Pack* b) { return a->get_name() < b->get_name(); });
+
+    // base pack number -> new pack number, for packs it already covers
+    std::vector<std::int64_t> renumber;
+    std::map<std::string, std::uint32_t> numbers;
+    for (std::uint32_t p = 0; p < ordered.size(); ++p) {
+        numbers[ordered[p]->get_name()] = p;
+    }
+    std::vector<bool> from_base(ordered.size(), false);
+    if (base && base->is_open()) {
+        for (const auto& name : base->get_pack_names()) {
+            auto it = numbers.find(name);
+            renumber.push_back(it == numbers.end() ? -1 : it->second);
+            if (it != numbers.end()) {
+                from_base[it->second] = true;
+            }
+        }
+    }
+
+    std::vector<Run> runs;
+    if (!renumber.empty() && base->size() > 0) {
+        runs.push_back({nullptr, 0, 0, base->size()});
+    }
+    for (std::uint32_t p = 0; p < ordered.size(); ++p) {
+        if (!from_base[p] && ordered[p]->get_index().size() > 0) {
+            runs.push_back({&ordered[p]->get_index(), p, 0, ordered[p]->get_index().size()});
+        }
+    }
+
+    auto head = [&](const Run& run) -> Entry {
+        if (run.index) {
+            return {run.index->id_at(run.position), run.pack, run.index->offset_at(run.position)};
+        }
+        std::int64_t pack = renumber[base->pack_at(run.position)];
+        return {base->id_at(run.position), static_cast<std::uint32_t>(pack < 0 ? 0 : pack),
+                base->offset_at(run.position)};
+    };
+    auto dropped = [&](const Run& run) {
+        if (run.index) {
+            return false;
+        }
+        std::uint32_t pack = base->pack_at(run.position);
+        return pack >= renumber.size() || renumber[pack] < 0;
+    };
+
+    // k-way merge; ties go to the lowest pack number, so the first pack in
+    // name order wins for duplicated objects
+    auto later = [&](size_t a, size_t b) {
+        Entry x = head(runs[a]);
+        Entry y = head(runs[b]);
+        int cmp = std::memcmp(x.id, y.id, ID_SIZE);
+        return cmp != 0 ? cmp > 0 : x.pack > y.pack;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    auto advance = [&](size_t r) {
+        Run& run = runs[r];
+        while (run.position < run.end && dropped(run)) {
+            ++run.position;
+        }
+        if (run.position < run.end) {
+            heap.push(r);
+        }
+    };
+    for (size_t r = 0; r < runs.size(); ++r) {
+        advance(r);
+    }
+
+    std::vector<Entry> entries;
+    while (!heap.empty()) {
+        size_t r = heap.top();
+        heap.pop();
+        Entry entry = head(runs[r]);
+        if (entries.empty() || std::memcmp(entries.back().id, entry.id, ID_SIZE) != 0) {
+            entries.push_back(entry);
+        }
+        ++runs[r].position;
+        advance(r);
+    }
+
+    std::string out(MIDX_MAGIC, 4);
+    utils::put_be32(out, MIDX_VERSION);
+    utils::put_be32(out, static_cast<std::uint32_t>(ordered.size()));
+    for (const Pack* pack : ordered) {
+        const std::string& name = pack->get_name();
+        out.push_back(static_cast<char>((name.size() >> 8) & 0xff));
+        out.push_back(static_cast<char>(name.size() & 0xff));
+        out += name;
+    }
+
+    std::uint32_t fanout[256] = {};
+    for (const Entry& entry : entries) {
+        ++fanout[entry.id[0]];
+    }
+    std::uint32_t running = 0;
+    for (std::uint32_t bucket : fanout) {
+        running += bucket;
+        utils::put_be32(out, running);
+    }
+    for (const Entry& entry : entries) {
+        out.append(reinterpret_cast<const char*>(entry.id), ID_SIZE);
+    }
+    for (const Entry& entry : entries) {
+        utils::put_be32(out, entry.pack);
+        utils::put_be64(out, entry.offset);
+    }
+
+    unsigned char digest[ID_SIZE];
+    HashContext<Policy>::digest(out.data(), out.size(), digest);
+    out.append(reinterpret_cast<const char*>(digest), ID_SIZE);
+
+    // A temporary unique to this writer, so concurrent repacks each rename
+    // a complete file into place
+    return utils::write_file_atomic(path, out);
+}
+
+template class BasicMultiPackIndex<Sha1Policy>;
+template class BasicMultiPackIndex<Sha256Policy>;
@@ -0,0 +1,13 @@
+#include "object_id.h"
+
+bool parse_object_format(const std::string& name, ObjectFormat& format) {
+    if (name == Sha1Policy::NAME) {
+        format = ObjectFormat::Sha1;
+        return true;
+    }
+    if (name == Sha256Policy::NAME) {
+        format = ObjectFormat::Sha256;
+        return true;
+    }
+    return false;
+}
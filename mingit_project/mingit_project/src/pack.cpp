@@ -0,0 +1,544 @@
+#include "pack.h"
+#include "delta.h"
+#include "dictionary.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+const char PACK_MAGIC[4] = {'M', 'G', 'P', 'K'};
+const char INDEX_MAGIC[4] = {'M', 'G', 'I', 'X'};
+const std::uint32_t FORMAT_VERSION = 1;
+// Packs with a compression dictionary
+const std::uint32_t DICTIONARY_VERSION = 2;
+
+const size_t PACK_HEADER_SIZE = 8;
+const size_t INDEX_HEADER_SIZE = 8;
+const size_t FANOUT_SIZE = 256 * 4;
+
+// Type byte plus up to four 10-byte varints
+const size_t MAX_ENTRY_HEADER = 41;
+// Guards against cycles in damaged packs
+const size_t MAX_DELTA_DEPTH = 4096;
+// Enough for any object header; see object_info_of
+const size_t INFO_PREFIX = 256;
+// A delta whose first bytes copy from further into its base than this is
+// read whole instead
+const size_t MAX_PREFIX_BASE = 64 << 10;
+
+bool parse_size(std::string_view text, std::uint64_t& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size() && !text.empty();
+}
+
+} // namespace
+
+bool fanout_is_sorted(const unsigned char* fanout) {
+    for (size_t i = 1; i < 256; ++i) {
+        if (utils::get_be32(fanout + i * 4) < utils::get_be32(fanout + (i - 1) * 4)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ObjectType object_type_of(const std::string& data) {
+    if (data.starts_with("commit ")) return ObjectType::Commit;
+    if (data.starts_with("blob ")) return ObjectType::Blob;
+    if (data.starts_with("large ")) return ObjectType::Large;
+    return ObjectType::None;
+}
+
+const char* object_type_name(ObjectType type) {
+    switch (type) {
+    case ObjectType::Commit: return "commit";
+    case ObjectType::Blob: return "blob";
+    case ObjectType::Large: return "large";
+    case ObjectType::OfsDelta: return "ofs-delta";
+    default: return "unknown";
+    }
+}
+
+// Blobs start "blob <size>"; those written before blobs became
+// name-independent start "blob <hash>", "filename <name>", "content
+// <size>". Large stubs are "large <size>".
+bool object_info_of(const std::string& prefix, std::uint64_t object_size, ObjectInfo& info) {
+    size_t line_end = prefix.find('\n');
+    if (line_end == std::string::npos) {
+        return false;
+    }
+    std::string_view header(prefix.data(), line_end);
+    info.type = object_type_of(prefix);
+    switch (info.type) {
+    case ObjectType::Commit:
+        info.size = object_size;
+        return object_size > 0;
+    case ObjectType::Large:
+        return parse_size(header.substr(6), info.size);
+    case ObjectType::Blob: {
+        if (header.size() != 5 + LEGACY_BLOB_ID_HEX_SIZE) {
+            return parse_size(header.substr(5), info.size);
+        }
+        size_t filename_end = prefix.find('\n', line_end + 1);
+        size_t length_end = filename_end == std::string::npos ? filename_end : prefix.find('\n', filename_end + 1);
+        if (length_end == std::string::npos) {
+            return false;
+        }
+        std::string_view length_line(prefix.data() + filename_end + 1, length_end - filename_end - 1);
+        return length_line.starts_with("content ") && parse_size(length_line.substr(8), info.size);
+    }
+    default:
+        return false;
+    }
+}
+
+template <class Policy>
+bool BasicPackIndex<Policy>::open(const std::string& path) {
+    if (!file.open(path)) {
+        return false;
+    }
+
+    const unsigned char* data = file.data();
+    if (file.size() < INDEX_HEADER_SIZE + FANOUT_SIZE ||
+        std::memcmp(data, INDEX_MAGIC, 4) != 0 || utils::get_be32(data + 4) != FORMAT_VERSION) {
+        file.close();
+        return false;
+    }
+
+    // Lookups index the tables by the count and the fan-out, so both are
+    // checked here: a damaged index is rejected, never read out of bounds
+    fanout = data + INDEX_HEADER_SIZE;
+    count = utils::get_be32(fanout + 255 * 4);
+    size_t expected = INDEX_HEADER_SIZE + FANOUT_SIZE + static_cast<size_t>(count) * (ID_SIZE + 8) + ID_SIZE;
+    if (file.size() != expected || !fanout_is_sorted(fanout)) {
+        file.close();
+        return false;
+    }
+
+    ids = fanout + FANOUT_SIZE;
+    offsets = ids + static_cast<size_t>(count) * ID_SIZE;
+    return true;
+}
+
+// The fan-out narrows the search to ids sharing the first byte; a binary
+// search finishes it.
+template <class Policy>
+bool BasicPackIndex<Policy>::find(const unsigned char* id, std::uint64_t& offset) const {
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::uint32_t low = id[0] == 0 ? 0 : utils::get_be32(fanout + (id[0] - 1) * 4);
+    std::uint32_t high = utils::get_be32(fanout + id[0] * 4);
+    while (low < high) {
+        std::uint32_t mid = low + (high - low) / 2;
+        int cmp = std::memcmp(id_at(mid), id, ID_SIZE);
+        if (cmp == 0) {
+            offset = offset_at(mid);
+            return true;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+template <class Policy>
+BasicPack<Policy>::BasicPack(WindowManager& windows, DeltaBaseCache* cache) : windows(windows), cache(cache) {
+}
+
+template <class Policy>
+BasicPack<Policy>::~BasicPack() {
+    windows.release(file);
+}
+
+template <class Policy>
+bool BasicPack<Policy>::open(const std::string& pack_dir, const std::string& pack_name) {
+    name = pack_name;
+    if (!index.open(pack_dir + "/" + pack_name + ".idx") ||
+        !file.open(pack_dir + "/" + pack_name + ".pack")) {
+        return false;
+    }
+
+    auto window = windows.map(file, 0, PACK_HEADER_SIZE + 4);
+    std::uint32_t version = window && file.size() >= PACK_HEADER_SIZE ? utils::get_be32(window->at(4)) : 0;
+    data_start = PACK_HEADER_SIZE;
+    if (version == DICTIONARY_VERSION && file.size() >= PACK_HEADER_SIZE + 4) {
+        std::uint32_t length = utils::get_be32(window->at(PACK_HEADER_SIZE));
+        data_start += 4 + length;
+        if (length <= dictionary::MAX_SIZE && data_start + ID_SIZE <= file.size()) {
+            window = windows.map(file, 0, static_cast<size_t>(data_start));
+            if (window) {
+                zlib_dictionary.assign(reinterpret_cast<const char*>(window->at(PACK_HEADER_SIZE + 4)), length);
+            }
+        }
+    }
+    if (file.size() < data_start + ID_SIZE || !window ||
+        std::memcmp(window->at(0), PACK_MAGIC, 4) != 0 ||
+        (version != FORMAT_VERSION && version != DICTIONARY_VERSION) ||
+        (version == DICTIONARY_VERSION && zlib_dictionary.empty())) {
+        windows.release(file);
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+template <class Policy>
+bool BasicPack<Policy>::read_header(std::uint64_t offset, EntryHeader& header) const {
+    std::uint64_t data_end = file.size() - ID_SIZE;
+    if (offset < data_start || offset >= data_end) {
+        return false;
+    }
+    auto window = windows.map(file, offset, MAX_ENTRY_HEADER);
+    if (!window) {
+        return false;
+    }
+
+    const unsigned char* start = window->at(offset);
+    const unsigned char* end = window->at(std::min<std::uint64_t>(data_end, window->offset() + window->size()));
+    const unsigned char* p = start;
+    header.type = static_cast<ObjectType>(*p++);
+    size_t used = utils::get_varint(p, end, header.size);
+    if (used == 0) {
+        return false;
+    }
+    p += used;
+    used = utils::get_varint(p, end, header.stored);
+    if (used == 0) {
+        return false;
+    }
+    p += used;
+    header.inflated = header.size;
+    if (header.type == ObjectType::OfsDelta) {
+        std::uint64_t distance = 0;
+        used = utils::get_varint(p, end, distance);
+        if (used == 0 || distance == 0 || distance > offset) {
+            return false;
+        }
+        p += used;
+        header.base_offset = offset - distance;
+        used = utils::get_varint(p, end, header.inflated);
+        if (used == 0) {
+            return false;
+        }
+        p += used;
+    }
+
+    header.length = static_cast<size_t>(p - start);
+    return header.stored <= data_end - offset - header.length;
+}
+
+template <class Policy>
+bool BasicPack<Policy>::inflate(std::uint64_t offset, const EntryHeader& header, std::string& out) const {
+    // Sizes come from the pack; one that does not fit size_t is corrupt
+    if (header.inflated != static_cast<size_t>(header.inflated) ||
+        header.stored != static_cast<size_t>(header.stored)) {
+        return false;
+    }
+    auto window = windows.map(file, offset, header.length + static_cast<size_t>(header.stored));
+    if (!window) {
+        return false;
+    }
+    out = utils::decompress(window->at(offset + header.length), static_cast<size_t>(header.stored),
+                            static_cast<size_t>(header.inflated), zlib_dictionary);
+    return !out.empty() || header.inflated == 0;
+}
+
+// Walks down the delta chain until a full object or a cached base, then
+// applies the deltas back up. Intermediate results are cached, since
+// neighbouring objects tend to be deltas against the same bases.
+template <class Policy>
+std::string BasicPack<Policy>::read(std::uint64_t offset) const {
+    std::vector<std::pair<std::uint64_t, EntryHeader>> chain;
+    std::shared_ptr<const std::string> base;
+    std::uint64_t current = offset;
+    while (true) {
+        if (cache && (base = cache->get(this, current))) {
+            if (chain.empty()) {
+                return *base;
+            }
+            break;
+        }
+        EntryHeader header;
+        if (!read_header(current, header)) {
+            return "";
+        }
+        if (header.type != ObjectType::OfsDelta) {
+            std::string data;
+            if (!inflate(current, header, data)) {
+                return "";
+            }
+            if (chain.empty()) {
+                return data;
+            }
+            base = std::make_shared<const std::string>(std::move(data));
+            if (cache) {
+                cache->put(this, current, base);
+            }
+            break;
+        }
+        if (chain.size() >= MAX_DELTA_DEPTH) {
+            return "";
+        }
+        chain.emplace_back(current, header);
+        current = header.base_offset;
+    }
+
+    std::string result;
+    for (size_t i = chain.size(); i-- > 0;) {
+        std::string delta_data;
+        if (!inflate(chain[i].first, chain[i].second, delta_data) ||
+            !delta::apply(*base, delta_data, result)) {
+            return "";
+        }
+        if (i > 0) {
+            base = std::make_shared<const std::string>(std::move(result));
+            if (cache) {
+                cache->put(this, chain[i].first, base);
+            }
+        }
+    }
+    return result;
+}
+
+template <class Policy>
+bool BasicPack<Policy>::read_prefix(std::uint64_t offset, size_t length, std::string& out, size_t depth) const {
+    if (cache) {
+        if (auto cached = cache->get(this, offset)) {
+            out = cached->substr(0, length);
+            return true;
+        }
+    }
+    EntryHeader header;
+    if (depth > MAX_DELTA_DEPTH || !read_header(offset, header)) {
+        return false;
+    }
+    auto window = windows.map(file, offset, header.length + static_cast<size_t>(header.stored));
+    if (!window) {
+        return false;
+    }
+    const unsigned char* data = window->at(offset + header.length);
+    size_t stored = static_cast<size_t>(header.stored);
+
+    size_t want = static_cast<size_t>(std::min<std::uint64_t>(length, header.size));
+    if (header.type != ObjectType::OfsDelta) {
+        out = utils::decompress_prefix(data, stored, want, zlib_dictionary);
+        return out.size() == want;
+    }
+
+    size_t delta_length = static_cast<size_t>(std::min<std::uint64_t>(header.inflated, 8 * want + 20));
+    std::string delta_data = utils::decompress_prefix(data, stored, delta_length, zlib_dictionary);
+    std::string base;
+    size_t base_needed = 0;
+    if (delta::apply_prefix(base, delta_data, want, out, base_needed)) {
+        return true;
+    }
+    return base_needed > 0 && base_needed <= MAX_PREFIX_BASE &&
+           read_prefix(header.base_offset, base_needed, base, depth + 1) &&
+           delta::apply_prefix(base, delta_data, want, out, base_needed);
+}
+
+template <class Policy>
+bool BasicPack<Policy>::read_info(std::uint64_t offset, ObjectInfo& info) const {
+    EntryHeader header;
+    std::string prefix;
+    return read_header(offset, header) && read_prefix(offset, INFO_PREFIX, prefix, 0) &&
+           object_info_of(prefix, header.size, info);
+}
+
+template <class Policy>
+bool BasicPack<Policy>::copy_raw(std::uint64_t offset, std::string& out) const {
+    EntryHeader header;
+    if (!read_header(offset, header) || header.type == ObjectType::OfsDelta) {
+        return false;
+    }
+    size_t length = header.length + static_cast<size_t>(header.stored);
+    auto window = windows.map(file, offset, length);
+    if (!window) {
+        return false;
+    }
+    // FDICT in the zlib header
+    const unsigned char* zlib = window->at(offset + header.length);
+    if (header.stored >= 2 && (zlib[1] & 0x20)) {
+        return false;
+    }
+    out.assign(reinterpret_cast<const char*>(window->at(offset)), length);
+    return true;
+}
+
+template <class Policy>
+BasicPackWriter<Policy>::BasicPackWriter(const std::string& pack_dir, int level)
+    : pack_dir(pack_dir), level(level) {
+}
+
+template <class Policy>
+BasicPackWriter<Policy>::~BasicPackWriter() {
+    if (!temp_path.empty()) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(temp_path, ec);
+    }
+}
+
+template <class Policy>
+void BasicPackWriter<Policy>::write_raw(std::string_view bytes) {
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    checksum.update(bytes.data(), bytes.size());
+    offset += bytes.size();
+}
+
+template <class Policy>
+void BasicPackWriter<Policy>::set_dictionary(std::string preset, size_t object_limit) {
+    zlib_dictionary = preset.substr(0, dictionary::MAX_SIZE);
+    dictionary_limit = object_limit;
+}
+
+template <class Policy>
+bool BasicPackWriter<Policy>::begin() {
+    utils::create_directory(pack_dir);
+    temp_path = utils::temp_path(pack_dir + "/tmp-pack");
+    out.open(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    checksum.reset();
+    std::string header(PACK_MAGIC, 4);
+    if (zlib_dictionary.empty()) {
+        utils::put_be32(header, FORMAT_VERSION);
+    } else {
+        utils::put_be32(header, DICTIONARY_VERSION);
+        utils::put_be32(header, static_cast<std::uint32_t>(zlib_dictionary.size()));
+        header += zlib_dictionary;
+    }
+    write_raw(header);
+    return true;
+}
+
+template <class Policy>
+bool BasicPackWriter<Policy>::add(const std::string& hash, const std::string& data) {
+    std::string id(ID_SIZE, '\0');
+    if (hash.size() != ID_SIZE * 2 ||
+        !utils::hex_decode(hash, reinterpret_cast<unsigned char*>(id.data()))) {
+        return false;
+    }
+
+    std::string compressed = utils::compress(data, level);
+    if (!zlib_dictionary.empty() && data.size() <= dictionary_limit) {
+        std::string with_dictionary = utils::compress(data, level, zlib_dictionary);
+        if (!with_dictionary.empty() && with_dictionary.size() < compressed.size()) {
+            compressed = std::move(with_dictionary);
+        }
+    }
+    std::string entry;
+    entry.push_back(static_cast<char>(object_type_of(data)));
+    utils::put_varint(entry, data.size());
+    utils::put_varint(entry, compressed.size());
+
+    entries.emplace_back(std::move(id), offset);
+    write_raw(entry);
+    write_raw(compressed);
+    return true;
+}
+
+template <class Policy>
+bool BasicPackWriter<Policy>::add_raw(const unsigned char* id, std::string_view entry) {
+    if (entry.empty()) {
+        return false;
+    }
+    entries.emplace_back(std::string(reinterpret_cast<const char*>(id), ID_SIZE), offset);
+    write_raw(entry);
+    return true;
+}
+
+template <class Policy>
+bool BasicPackWriter<Policy>::add_delta(const std::string& hash, std::uint64_t base_offset, const std::string& delta,
+                                        std::uint64_t object_size) {
+    std::string id(ID_SIZE, '\0');
+    if (base_offset >= offset || hash.size() != ID_SIZE * 2 ||
+        !utils::hex_decode(hash, reinterpret_cast<unsigned char*>(id.data()))) {
+        return false;
+    }
+
+    std::string compressed = utils::compress(delta, level);
+    std::string entry;
+    entry.push_back(static_cast<char>(ObjectType::OfsDelta));
+    utils::put_varint(entry, object_size);
+    utils::put_varint(entry, compressed.size());
+    utils::put_varint(entry, offset - base_offset);
+    utils::put_varint(entry, delta.size());
+
+    entries.emplace_back(std::move(id), offset);
+    write_raw(entry);
+    write_raw(compressed);
+    return true;
+}
+
+template <class Policy>
+std::string BasicPackWriter<Policy>::finish() {
+    unsigned char digest[ID_SIZE];
+    checksum.finish(digest);
+    out.write(reinterpret_cast<const char*>(digest), ID_SIZE);
+    out.close();
+    std::error_code ec;
+    if (!out) {
+        std::filesystem::remove(temp_path, ec);
+        return "";
+    }
+
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const auto& a, const auto& b) { return a.first == b.first; }),
+                  entries.end());
+
+    std::string index(INDEX_MAGIC, 4);
+    utils::put_be32(index, FORMAT_VERSION);
+    std::uint32_t fanout[256] = {};
+    for (const auto& [id, _] : entries) {
+        ++fanout[static_cast<unsigned char>(id[0])];
+    }
+    std::uint32_t running = 0;
+    for (std::uint32_t bucket : fanout) {
+        running += bucket;
+        utils::put_be32(index, running);
+    }
+    for (const auto& [id, _] : entries) {
+        index += id;
+    }
+    for (const auto& [_, entry_offset] : entries) {
+        utils::put_be64(index, entry_offset);
+    }
+    index.append(reinterpret_cast<const char*>(digest), ID_SIZE);
+
+    // The index is written before the pack is renamed into place, so a
+    // reader never sees a pack without its index
+    std::string name = "pack-" + utils::hex_encode(digest, ID_SIZE);
+    std::string index_path = pack_dir + "/" + name + ".idx";
+    if (!utils::write_file_atomic(index_path, index)) {
+        std::filesystem::remove(temp_path, ec);
+        return "";
+    }
+    std::string pack_path = pack_dir + "/" + name + ".pack";
+    if (!utils::rename_file(temp_path, pack_path)) {
+        // An identical pack already in place keeps its index
+        if (!utils::file_exists(pack_path)) {
+            std::filesystem::remove(index_path, ec);
+        }
+        return "";
+    }
+    temp_path.clear();
+    return name;
+}
+
+template class BasicPackIndex<Sha1Policy>;
+template class BasicPackIndex<Sha256Policy>;
+template class BasicPack<Sha1Policy>;
+template class BasicPack<Sha256Policy>;
+template class BasicPackWriter<Sha1Policy>;
+template class BasicPackWriter<Sha256Policy>;
@@ -0,0 +1,217 @@
+#include "pack_builder.h"
+#include "delta.h"
+#include "dictionary.h"
+#include "executor.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <memory>
+#include <tuple>
+
+namespace {
+
+// Objects per search chunk. Fixed rather than derived from the thread
+// count, which keeps the output deterministic.
+const size_t CHUNK_SIZE = 1024;
+// Objects smaller than this are never worth a delta
+const std::uint64_t MIN_DELTA_SIZE = 64;
+// Small objects read to train a dictionary, at most
+const std::uint64_t SAMPLE_BUDGET = 1 << 20;
+// Below this much small-object data a dictionary costs more than it saves
+const std::uint64_t MIN_DICTIONARY_INPUT = 256 << 10;
+
+} // namespace
+
+template <class Policy>
+struct BasicPackBuilder<Policy>::ChunkResult {
+    std::vector<std::string> data;
+    std::vector<long> base;          // chunk-relative base index, -1 for none
+    std::vector<std::string> delta;
+};
+
+template <class Policy>
+BasicPackBuilder<Policy>::BasicPackBuilder(const std::string& pack_dir, const Options& options)
+    : pack_dir(pack_dir), options(options) {
+}
+
+template <class Policy>
+std::uint32_t BasicPackBuilder<Policy>::path_hash(const std::string& path) {
+    std::uint32_t hash = 0;
+    for (unsigned char c : path) {
+        if (std::isspace(c)) {
+            continue;
+        }
+        hash = (hash >> 2) + (static_cast<std::uint32_t>(c) << 24);
+    }
+    return hash;
+}
+
+template <class Policy>
+void BasicPackBuilder<Policy>::search(size_t begin, size_t end, const Reader& read, ChunkResult& result) const {
+    struct Candidate {
+        size_t index;
+        std::unique_ptr<delta::Index> index_data;
+        size_t memory;
+    };
+
+    size_t n = end - begin;
+    // Sized up front: candidate indexes refer into `data`
+    result.data.resize(n);
+    result.base.assign(n, -1);
+    result.delta.resize(n);
+    std::vector<unsigned> depth(n, 0);
+    std::deque<Candidate> window;
+    size_t window_bytes = 0;
+
+    for (size_t k = 0; k < n; ++k) {
+        const Object& object = objects[begin + k];
+        result.data[k] = read(object.hash);
+        if (result.data[k].empty() || options.window == 0 || object.size < MIN_DELTA_SIZE) {
+            continue;
+        }
+
+        // A delta must at least halve the object to be worth its
+        // reconstruction cost; each success tightens the limit
+        size_t limit = result.data[k].size() / 2;
+        for (auto it = window.rbegin(); it != window.rend() && limit > 0; ++it) {
+            const Object& base = objects[begin + it->index];
+            if (base.type != object.type || depth[it->index] >= options.depth ||
+                base.size < object.size / 32) {
+                continue;
+            }
+            std::string delta = it->index_data->create(result.data[k], limit);
+            if (!delta.empty()) {
+                result.base[k] = static_cast<long>(it->index);
+                result.delta[k] = std::move(delta);
+                limit = result.delta[k].size() - 1;
+            }
+        }
+        if (result.base[k] >= 0) {
+            depth[k] = depth[result.base[k]] + 1;
+        }
+
+        auto index_data = std::make_unique<delta::Index>(result.data[k]);
+        size_t memory = result.data[k].size() + index_data->memory();
+        window.push_back({k, std::move(index_data), memory});
+        window_bytes += memory;
+        while (window.size() > options.window ||
+               (options.window_memory && window_bytes > options.window_memory && window.size() > 1)) {
+            window_bytes -= window.front().memory;
+            window.pop_front();
+        }
+    }
+}
+
+// Samples are spread evenly over the sorted objects, so every type and
+// kind of file is represented
+template <class Policy>
+std::string BasicPackBuilder<Policy>::train_dictionary(const Reader& read) const {
+    std::vector<const Object*> small;
+    std::uint64_t total = 0;
+    for (const auto& object : objects) {
+        if (object.size <= options.dictionary_threshold) {
+            small.push_back(&object);
+            total += object.size;
+        }
+    }
+    if (total < MIN_DICTIONARY_INPUT) {
+        return "";
+    }
+
+    size_t stride = static_cast<size_t>((total + SAMPLE_BUDGET - 1) / SAMPLE_BUDGET);
+    std::vector<std::string> samples((small.size() + stride - 1) / stride);
+    Executor::shared().parallel_for(samples.size(), [&](size_t i) {
+        samples[i] = read(small[i * stride]->hash);
+    });
+    return dictionary::train(samples, std::min<std::uint64_t>(dictionary::MAX_SIZE, total / 8));
+}
+
+// Chunks are searched a thread's worth at a time and written in sorted
+// order before the next group starts, so only that group's objects are
+// held in memory. A delta's base always precedes it in the sorted order,
+// and so in the pack.
+template <class Policy>
+std::string BasicPackBuilder<Policy>::write(const Reader& read, const RawReader& raw) {
+    std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) {
+        return std::make_tuple(a.type, a.path_hash, b.size, std::cref(a.hash)) <
+               std::make_tuple(b.type, b.path_hash, a.size, std::cref(b.hash));
+    });
+    objects.erase(std::unique(objects.begin(), objects.end(),
+                              [](const Object& a, const Object& b) { return a.hash == b.hash; }),
+                  objects.end());
+
+    // Chunk ends move past runs of the same path, up to twice the size,
+    // so versions of one file are searched together
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (size_t begin = 0; begin < objects.size();) {
+        size_t end = std::min(objects.size(), begin + CHUNK_SIZE);
+        while (end < objects.size() && end < begin + 2 * CHUNK_SIZE &&
+               objects[end].type == objects[end - 1].type &&
+               objects[end].path_hash == objects[end - 1].path_hash) {
+            ++end;
+        }
+        chunks.emplace_back(begin, end);
+        begin = end;
+    }
+
+    PackWriter writer(pack_dir, options.level);
+    if (options.dictionary_threshold > 0) {
+        writer.set_dictionary(train_dictionary(read), options.dictionary_threshold);
+    }
+    if (!writer.begin()) {
+        utils::print_error("Failed to create pack in " + pack_dir);
+        return "";
+    }
+
+    Executor& executor = Executor::shared();
+    size_t group_size = std::max<size_t>(1, executor.size());
+    deltas = 0;
+    bool ok = true;
+    for (size_t group = 0; group < chunks.size() && ok; group += group_size) {
+        size_t group_end = std::min(chunks.size(), group + group_size);
+        std::vector<ChunkResult> results(group_end - group);
+        executor.parallel_for(results.size(), [&](size_t c) {
+            search(chunks[group + c].first, chunks[group + c].second, read, results[c]);
+        });
+
+        for (size_t c = 0; c < results.size() && ok; ++c) {
+            ChunkResult& result = results[c];
+            size_t begin = chunks[group + c].first;
+            std::vector<std::uint64_t> offsets(result.data.size());
+            for (size_t k = 0; k < result.data.size(); ++k) {
+                const Object& object = objects[begin + k];
+                offsets[k] = writer.tell();
+                std::string entry;
+                unsigned char id[Policy::DIGEST_SIZE];
+                bool written = false;
+                if (result.data[k].empty()) {
+                    // Reported below
+                } else if (result.base[k] >= 0) {
+                    written = writer.add_delta(object.hash, offsets[result.base[k]], result.delta[k],
+                                               result.data[k].size());
+                    deltas += written;
+                } else if (raw && raw(object.hash, entry) && utils::hex_decode(object.hash, id)) {
+                    written = writer.add_raw(id, entry);
+                } else {
+                    written = writer.add(object.hash, result.data[k]);
+                }
+                if (!written) {
+                    utils::print_error("Failed to read object " + object.hash);
+                    ok = false;
+                    break;
+                }
+                std::string().swap(result.data[k]);
+                std::string().swap(result.delta[k]);
+            }
+        }
+    }
+
+    if (!ok) {
+        return "";
+    }
+    return writer.finish();
+}
+
+template class BasicPackBuilder<Sha1Policy>;
+template class BasicPackBuilder<Sha256Policy>;
@@ -0,0 +1,203 @@
+#include "pack_cache.h"
+#include <algorithm>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+WindowedFile::~WindowedFile() {
+    close();
+}
+
+bool WindowedFile::open(const std::string& filename) {
+    close();
+    path = filename;
+#ifndef _WIN32
+    fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        close();
+        return false;
+    }
+    length = static_cast<std::uint64_t>(st.st_size);
+#else
+    std::error_code ec;
+    length = std::filesystem::file_size(filename, ec);
+    if (ec) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+void WindowedFile::close() {
+#ifndef _WIN32
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+    length = 0;
+}
+
+PackWindow::~PackWindow() {
+#ifndef _WIN32
+    if (mapping) {
+        ::munmap(mapping, mapping_length);
+    }
+#endif
+}
+
+WindowManager::WindowManager(size_t window_size, size_t memory_limit)
+    : window_size(std::max<size_t>(window_size, 64 << 10)), memory_limit(memory_limit) {
+#ifndef _WIN32
+    // Window starts must be page aligned for mmap
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    this->window_size = (this->window_size + page - 1) / page * page;
+#endif
+}
+
+std::shared_ptr<PackWindow> WindowManager::map_window(const WindowedFile& file, std::uint64_t start,
+                                                      size_t length) {
+    auto window = std::make_shared<PackWindow>();
+    window->start = start;
+    window->length = length;
+#ifndef _WIN32
+    void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file.fd, static_cast<off_t>(start));
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+    window->mapping = map;
+    window->mapping_length = length;
+    window->bytes = static_cast<const unsigned char*>(map);
+#else
+    std::ifstream in(file.path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(start));
+    window->fallback.resize(length);
+    in.read(window->fallback.data(), static_cast<std::streamsize>(length));
+    if (static_cast<size_t>(in.gcount()) != length) {
+        return nullptr;
+    }
+    window->bytes = reinterpret_cast<const unsigned char*>(window->fallback.data());
+#endif
+    return window;
+}
+
+// Windows a caller still holds have a use count above one and are skipped;
+// if all are in use the limit is exceeded until they are released.
+void WindowManager::evict_idle() {
+    for (auto it = lru.end(); mapped > memory_limit && it != lru.begin();) {
+        --it;
+        auto entry = windows.find(*it);
+        if (entry->second.first.use_count() > 1) {
+            continue;
+        }
+        mapped -= entry->second.first->size();
+        windows.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+std::shared_ptr<const PackWindow> WindowManager::map(const WindowedFile& file, std::uint64_t offset,
+                                                     size_t length) {
+    if (offset >= file.size()) {
+        return nullptr;
+    }
+    std::uint64_t end = std::min<std::uint64_t>(file.size(), offset + length);
+    std::uint64_t start = offset / window_size * window_size;
+    size_t wanted = static_cast<size_t>(std::min<std::uint64_t>(
+        file.size() - start, std::max<std::uint64_t>(window_size, end - start)));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key(&file, start);
+    auto it = windows.find(key);
+    if (it != windows.end()) {
+        if (it->second.first->size() >= end - start) {
+            lru.splice(lru.begin(), lru, it->second.second);
+            return it->second.first;
+        }
+        // Too short for this request; a holder keeps the old one alive
+        mapped -= it->second.first->size();
+        lru.erase(it->second.second);
+        windows.erase(it);
+    }
+
+    auto window = map_window(file, start, wanted);
+    if (!window) {
+        return nullptr;
+    }
+    lru.push_front(key);
+    windows[key] = {window, lru.begin()};
+    mapped += window->size();
+    evict_idle();
+    return window;
+}
+
+void WindowManager::release(const WindowedFile& file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = windows.begin(); it != windows.end();) {
+        if (it->first.first == &file) {
+            mapped -= it->second.first->size();
+            lru.erase(it->second.second);
+            it = windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t WindowManager::mapped_bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return mapped;
+}
+
+DeltaBaseCache::DeltaBaseCache(size_t memory_limit) : memory_limit(memory_limit) {
+}
+
+std::shared_ptr<const std::string> DeltaBaseCache::get(const void* pack, std::uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(Key(pack, offset));
+    if (it == entries.end()) {
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second.second);
+    return it->second.first;
+}
+
+void DeltaBaseCache::put(const void* pack, std::uint64_t offset, std::shared_ptr<const std::string> data) {
+    if (!data || data->size() > memory_limit) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key(pack, offset);
+    if (entries.count(key)) {
+        return;
+    }
+    lru.push_front(key);
+    used += data->size();
+    entries[key] = {std::move(data), lru.begin()};
+
+    while (used > memory_limit && !lru.empty()) {
+        auto oldest = entries.find(lru.back());
+        used -= oldest->second.first->size();
+        entries.erase(oldest);
+        lru.pop_back();
+    }
+}
+
+void DeltaBaseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    used = 0;
+}
@@ -0,0 +1,162 @@
+#include "pack_store.h"
+#include <algorithm>
+#include <map>
+
+template <class Policy>
+BasicPackStore<Policy>::BasicPackStore(const std::string& pack_dir, size_t window_size, size_t window_limit,
+                                       size_t delta_cache_limit)
+    : pack_dir(pack_dir), windows(window_size, window_limit), delta_cache(delta_cache_limit) {
+}
+
+template <class Policy>
+void BasicPackStore<Policy>::load() {
+    midx.close();
+    midx_packs.clear();
+    unindexed.clear();
+    packs.clear();
+    // Cached bases are keyed by Pack address, which a new Pack may reuse
+    delta_cache.clear();
+
+    std::vector<std::string> names;
+    for (const auto& file : utils::list_files(pack_dir)) {
+        if (file.starts_with("pack-") && file.ends_with(".pack")) {
+            names.push_back(file.substr(0, file.size() - 5));
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    std::map<std::string, const Pack*> by_name;
+    for (const auto& name : names) {
+        auto pack = std::make_unique<Pack>(windows, &delta_cache);
+        if (!pack->open(pack_dir, name)) {
+            utils::print_warning("Ignoring unreadable pack " + name);
+            continue;
+        }
+        by_name[name] = pack.get();
+        packs.push_back(std::move(pack));
+    }
+
+    // A midx naming a pack that no longer exists is stale; fall back to the
+    // per-pack indexes until it is rewritten
+    if (midx.open(pack_dir + "/multi-pack-index")) {
+        for (const auto& name : midx.get_pack_names()) {
+            auto it = by_name.find(name);
+            if (it == by_name.end()) {
+                midx.close();
+                midx_packs.clear();
+                break;
+            }
+            midx_packs.push_back(it->second);
+        }
+    }
+
+    for (const auto& pack : packs) {
+        if (std::find(midx_packs.begin(), midx_packs.end(), pack.get()) == midx_packs.end()) {
+            unindexed.push_back(pack.get());
+        }
+    }
+}
+
+template <class Policy>
+bool BasicPackStore<Policy>::find(const std::string& hash, PackLocation& location) const {
+    unsigned char id[ID_SIZE];
+    if (packs.empty() || hash.size() != ID_SIZE * 2 || !utils::hex_decode(hash, id)) {
+        return false;
+    }
+
+    std::uint32_t pack_number = 0;
+    if (midx.find(id, pack_number, location.offset)) {
+        location.pack = midx_packs[pack_number];
+        return true;
+    }
+    for (const Pack* pack : unindexed) {
+        if (pack->get_index().find(id, location.offset)) {
+            location.pack = pack;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Policy>
+bool BasicPackStore<Policy>::has(const std::string& hash) const {
+    PackLocation location;
+    return find(hash, location);
+}
+
+template <class Policy>
+std::string BasicPackStore<Policy>::read(const std::string& hash) const {
+    PackLocation location;
+    if (!find(hash, location)) {
+        return "";
+    }
+    return location.pack->read(location.offset);
+}
+
+template <class Policy>
+std::vector<const BasicPack<Policy>*> BasicPackStore<Policy>::geometric_rollup(unsigned factor,
+                                                                             size_t loose_objects) const {
+    std::vector<const Pack*> sorted;
+    for (const auto& pack : packs) {
+        sorted.push_back(pack.get());
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Pack* a, const Pack* b) {
+        return a->get_index().size() < b->get_index().size();
+    });
+    auto objects = [&](size_t i) { return static_cast<std::uint64_t>(sorted[i]->get_index().size()); };
+
+    // Everything below the highest pack that breaks the progression has to
+    // be merged...
+    size_t split = 0;
+    for (size_t i = sorted.size(); i-- > 1;) {
+        if (objects(i) < factor * objects(i - 1)) {
+            split = i;
+            break;
+        }
+    }
+
+    // ...and the merged pack may in turn be too big for the packs above it
+    std::uint64_t total = loose_objects;
+    for (size_t i = 0; i < split; ++i) {
+        total += objects(i);
+    }
+    while (split < sorted.size() && objects(split) < factor * total) {
+        total += objects(split);
+        ++split;
+    }
+
+    sorted.resize(split);
+    return sorted;
+}
+
+template <class Policy>
+bool BasicPackStore<Policy>::write_multi_pack_index(const std::set<std::string>& excluded) {
+    std::vector<const Pack*> covered;
+    for (const auto& pack : packs) {
+        if (!excluded.count(pack->get_name())) {
+            covered.push_back(pack.get());
+        }
+    }
+    bool ok = MultiPackIndex::write(pack_dir + "/multi-pack-index", covered, &midx);
+    load();
+    return ok;
+}
+
+template <class Policy>
+void BasicPackStore<Policy>::remove_packs(const std::set<std::string>& names) {
+    // Unmap before deleting
+    midx.close();
+    midx_packs.clear();
+    unindexed.clear();
+    packs.clear();
+
+    std::error_code ec;
+    for (const auto& name : names) {
+        std::filesystem::remove(pack_dir + "/" + name + ".pack", ec);
+        std::filesystem::remove(pack_dir + "/" + name + ".idx", ec);
+    }
+    load();
+}
+
+template class BasicPackStore<Sha1Policy>;
+template class BasicPackStore<Sha256Policy>;
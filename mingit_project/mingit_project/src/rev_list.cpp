@@ -0,0 +1,198 @@
+#include "minigit.h"
+#include "utils.h"
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <queue>
+#include <tuple>
+
+namespace {
+
+// Commits loaded per load_objects call when listing their files
+const size_t OBJECT_BATCH = 256;
+
+// Set of binary object ids in one flat open-addressed table: one id a
+// slot and no allocation per entry. Ids are uniformly distributed, so
+// their first bytes serve as the hash.
+template <class Policy>
+class ObjectIdSet {
+private:
+    using Id = ObjectId<Policy>;
+
+    std::vector<Id> slots;
+    std::vector<bool> occupied;
+    size_t count = 0;
+
+    size_t capacity() const { return occupied.size(); }
+
+    size_t slot_of(const Id& id) const {
+        std::uint64_t hash = 0;
+        std::memcpy(&hash, id.data(), sizeof(hash));
+        size_t mask = capacity() - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (occupied[slot] && slots[slot] != id) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void grow() {
+        std::vector<Id> old_slots = std::move(slots);
+        std::vector<bool> old_occupied = std::move(occupied);
+        size_t new_capacity = old_occupied.empty() ? 1024 : 2 * old_occupied.size();
+        slots.assign(new_capacity, Id{});
+        occupied.assign(new_capacity, false);
+        for (size_t i = 0; i < old_occupied.size(); ++i) {
+            if (old_occupied[i]) {
+                size_t slot = slot_of(old_slots[i]);
+                slots[slot] = old_slots[i];
+                occupied[slot] = true;
+            }
+        }
+    }
+
+public:
+    // False if `id` was already present
+    bool insert(const Id& id) {
+        if (4 * (count + 1) > 3 * capacity()) {
+            grow();
+        }
+        size_t slot = slot_of(id);
+        if (occupied[slot]) {
+            return false;
+        }
+        slots[slot] = id;
+        occupied[slot] = true;
+        ++count;
+        return true;
+    }
+
+    bool insert(const std::string& hash) {
+        Id id;
+        return Id::parse(hash, id) && insert(id);
+    }
+};
+
+} // namespace
+
+// Commits come out newest first, as they are walked. Those in the
+// commit-graph are walked from it alone and marked seen in a bitset over
+// graph positions; only commits outside it are loaded. With `objects`,
+// the commits' files follow, loaded in batches, each blob listed once
+// with the first path it was found under. There are no reachability
+// bitmaps; the walk is linear in the objects listed.
+template <class Policy>
+bool BasicMiniGit<Policy>::rev_list(const std::vector<std::string>& revisions, bool objects, std::ostream& out) {
+    if (!is_initialized) {
+        utils::report_error("Not a MiniGit repository");
+        return false;
+    }
+
+    std::vector<std::string> tips;
+    for (const auto& revision : revisions) {
+        if (revision == "--all") {
+            for (const auto& tip : reference_tips()) {
+                tips.push_back(tip);
+            }
+        } else if (revision == "HEAD") {
+            tips.push_back(load_head());
+        } else if (branches.count(revision)) {
+            tips.push_back(branches[revision]->get_commit_hash());
+        } else if (is_object_id(revision)) {
+            tips.push_back(revision);
+        } else {
+            utils::report_error("Unknown revision: " + revision);
+            return false;
+        }
+    }
+
+    struct Item {
+        std::time_t timestamp;
+        std::string hash;
+        bool in_graph;
+        std::uint32_t position;
+        std::vector<std::string> parents; // when not in the graph
+        bool operator<(const Item& other) const {
+            return std::tie(timestamp, hash) < std::tie(other.timestamp, other.hash);
+        }
+    };
+
+    const CommitGraphChain& graph = commit_graph();
+    std::vector<bool> graph_seen(graph.size(), false);
+    ObjectIdSet<Policy> seen;
+    std::priority_queue<Item> queue;
+    bool ok = true;
+
+    auto push_position = [&](std::uint32_t position) {
+        if (!graph_seen[position]) {
+            graph_seen[position] = true;
+            queue.push({graph.timestamp(position), graph.hash_at(position), true, position, {}});
+        }
+    };
+    auto push_hash = [&](const std::string& hash) {
+        std::uint32_t position = 0;
+        if (graph.find(hash, position)) {
+            push_position(position);
+            return;
+        }
+        if (!seen.insert(hash)) {
+            return;
+        }
+        auto commit = load_commit(hash);
+        if (!commit) {
+            utils::report_error("Missing commit " + hash);
+            ok = false;
+            return;
+        }
+        queue.push({commit->get_timestamp(), hash, false, 0, commit->get_parents()});
+    };
+
+    for (const auto& tip : tips) {
+        if (!tip.empty()) {
+            push_hash(tip);
+        }
+    }
+
+    std::vector<std::string> commits;
+    while (!queue.empty()) {
+        Item item = queue.top();
+        queue.pop();
+        out << item.hash << '\n';
+        if (objects) {
+            commits.push_back(item.hash);
+        }
+        if (item.in_graph) {
+            for (std::uint32_t parent : graph.parents(item.position)) {
+                push_position(parent);
+            }
+        } else {
+            for (const auto& parent : item.parents) {
+                push_hash(parent);
+            }
+        }
+    }
+
+    for (size_t begin = 0; begin < commits.size(); begin += OBJECT_BATCH) {
+        std::vector<std::string> batch(commits.begin() + begin,
+                                       commits.begin() + std::min(commits.size(), begin + OBJECT_BATCH));
+        std::map<std::string, std::map<std::string, std::string>> files;
+        load_objects(batch, [&files](const std::string& hash, const std::string& data) {
+            if (auto commit = data.empty() ? nullptr : Commit::from_string(data)) {
+                files[hash] = commit->get_files();
+            }
+        });
+        for (const auto& hash : batch) {
+            for (const auto& [filename, blob] : files[hash]) {
+                if (seen.insert(blob)) {
+                    out << blob << ' ' << filename << '\n';
+                }
+            }
+        }
+    }
+
+    out.flush();
+    return ok;
+}
+
+template bool BasicMiniGit<Sha1Policy>::rev_list(const std::vector<std::string>&, bool, std::ostream&);
+template bool BasicMiniGit<Sha256Policy>::rev_list(const std::vector<std::string>&, bool, std::ostream&);
@@ -0,0 +1,95 @@
+#include "sha1_multi.h"
+#include "cpu.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+void prepare(sha1_multi::Lane& lane, std::string_view input) {
+    static const std::uint32_t INITIAL[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    lane = sha1_multi::Lane();
+    lane.data = reinterpret_cast<const unsigned char*>(input.data());
+    lane.full_blocks = input.size() / 64;
+    size_t rest = input.size() % 64;
+    std::memcpy(lane.tail, input.data() + 64 * lane.full_blocks, rest);
+    lane.tail[rest] = 0x80;
+    size_t tail_blocks = rest + 9 <= 64 ? 1 : 2;
+    std::uint64_t bits = static_cast<std::uint64_t>(input.size()) * 8;
+    for (size_t i = 0; i < 8; ++i) {
+        lane.tail[64 * tail_blocks - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+    lane.total_blocks = lane.full_blocks + tail_blocks;
+    std::memcpy(lane.state, INITIAL, sizeof(INITIAL));
+}
+
+std::string digest_of(const sha1_multi::Lane& lane) {
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    for (size_t i = 0; i < 5; ++i) {
+        digest[4 * i] = static_cast<unsigned char>(lane.state[i] >> 24);
+        digest[4 * i + 1] = static_cast<unsigned char>(lane.state[i] >> 16);
+        digest[4 * i + 2] = static_cast<unsigned char>(lane.state[i] >> 8);
+        digest[4 * i + 3] = static_cast<unsigned char>(lane.state[i]);
+    }
+    return utils::hex_encode(digest, SHA_DIGEST_LENGTH);
+}
+
+} // namespace
+
+size_t sha1_multi::lanes() {
+    return cpu::kernels().sha1_lanes;
+}
+
+std::vector<std::string> sha1_multi::hash(const std::vector<std::string_view>& inputs) {
+    const cpu::Kernels& kernels = cpu::kernels();
+    if (!kernels.sha1_compress || inputs.size() < 2) {
+        std::vector<std::string> digests(inputs.size());
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            unsigned char digest[SHA_DIGEST_LENGTH];
+            SHA1(reinterpret_cast<const unsigned char*>(inputs[i].data()), inputs[i].size(), digest);
+            digests[i] = utils::hex_encode(digest, SHA_DIGEST_LENGTH);
+        }
+        return digests;
+    }
+    return hash_with(kernels.sha1_compress, kernels.sha1_lanes, inputs);
+}
+
+std::vector<std::string> sha1_multi::hash_with(void (*compress)(Lane*), size_t lanes,
+                                               const std::vector<std::string_view>& inputs) {
+    std::vector<std::string> digests(inputs.size());
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&inputs](size_t a, size_t b) { return inputs[a].size() < inputs[b].size(); });
+
+    std::vector<Lane> group(lanes);
+    for (size_t begin = 0; begin < order.size(); begin += lanes) {
+        size_t count = std::min(lanes, order.size() - begin);
+        for (size_t l = 0; l < lanes; ++l) {
+            if (l < count) {
+                prepare(group[l], inputs[order[begin + l]]);
+            } else {
+                group[l] = Lane();
+            }
+        }
+        compress(group.data());
+        for (size_t l = 0; l < count; ++l) {
+            digests[order[begin + l]] = digest_of(group[l]);
+        }
+    }
+    return digests;
+}
+
+// The lanes read each message from one buffer, so header and payload are
+// joined into a copy first
+std::vector<std::string> sha1_multi::hash_objects(const std::string& type,
+                                                  const std::vector<std::string_view>& payloads) {
+    std::vector<std::string> objects;
+    objects.reserve(payloads.size());
+    for (std::string_view payload : payloads) {
+        objects.push_back(utils::object_header(type, payload.size()));
+        objects.back().append(payload);
+    }
+    return hash(std::vector<std::string_view>(objects.begin(), objects.end()));
+}
@@ -0,0 +1,31 @@
+// Built with -mavx2; only called once the CPU is known to support it
+#include "sha1_lanes.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2 {
+    using Vec = __m256i;
+    static constexpr unsigned LANES = 8;
+
+    static Vec load(const std::uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const Vec*>(p)); }
+    static void store(std::uint32_t* p, Vec v) { _mm256_store_si256(reinterpret_cast<Vec*>(p), v); }
+    static Vec set1(std::uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    static Vec xor2(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+    static Vec xor3(Vec a, Vec b, Vec c) { return _mm256_xor_si256(_mm256_xor_si256(a, b), c); }
+    // b ? c : d, bitwise
+    static Vec choose(Vec b, Vec c, Vec d) { return _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d))); }
+    static Vec majority(Vec b, Vec c, Vec d) {
+        return _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+    }
+    static Vec select(Vec mask, Vec yes, Vec no) { return _mm256_blendv_epi8(no, yes, mask); }
+    template <int N>
+    static Vec rotl(Vec x) { return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N)); }
+};
+
+} // namespace
+
+void sha1_multi::compress_avx2(Lane* lanes) {
+    compress_lanes<Avx2>(lanes);
+}
@@ -0,0 +1,34 @@
+// Built with -mavx512f; only called once the CPU is known to support it
+#include "sha1_lanes.h"
+#include <immintrin.h>
+
+namespace {
+
+// Rotates and the three-input boolean functions are single instructions
+struct Avx512 {
+    using Vec = __m512i;
+    static constexpr unsigned LANES = 16;
+
+    static Vec load(const std::uint32_t* p) { return _mm512_load_si512(p); }
+    static void store(std::uint32_t* p, Vec v) { _mm512_store_si512(p, v); }
+    static Vec set1(std::uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    static Vec add(Vec a, Vec b) { return _mm512_add_epi32(a, b); }
+    static Vec xor2(Vec a, Vec b) { return _mm512_xor_si512(a, b); }
+    static Vec xor3(Vec a, Vec b, Vec c) { return _mm512_ternarylogic_epi32(a, b, c, 0x96); }
+    static Vec choose(Vec b, Vec c, Vec d) { return _mm512_ternarylogic_epi32(b, c, d, 0xCA); }
+    static Vec majority(Vec b, Vec c, Vec d) { return _mm512_ternarylogic_epi32(b, c, d, 0xE8); }
+    static Vec select(Vec mask, Vec yes, Vec no) {
+        return _mm512_mask_blend_epi32(_mm512_test_epi32_mask(mask, mask), no, yes);
+    }
+    // The masked form with every lane selected is the same instruction;
+    // the unmasked intrinsic passes GCC an uninitialized source that it
+    // warns about at -O2
+    template <int N>
+    static Vec rotl(Vec x) { return _mm512_mask_rol_epi32(x, 0xFFFF, x, N); }
+};
+
+} // namespace
+
+void sha1_multi::compress_avx512(Lane* lanes) {
+    compress_lanes<Avx512>(lanes);
+}
@@ -1,6 +1,22 @@
 #include "utils.h"
+#include "cpu.h"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace utils {
 
@@ -25,6 +41,39 @@ bool write_file(const std::string& filename, const std::string& content) {
     return true;
 }
 
+bool write_file_atomic(const std::string& filename, const std::string& content) {
+    std::string temp = temp_path(filename);
+    std::ofstream file(temp, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    file << content;
+    file.close();
+    if (!file) {
+        std::error_code ec;
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return rename_file(temp, filename);
+}
+
+std::string temp_path(const std::string& path) {
+    static const std::string process = std::to_string(std::random_device{}());
+    static std::atomic<std::uint64_t> counter{0};
+    return path + ".tmp-" + process + "-" + std::to_string(counter++);
+}
+
+bool rename_file(const std::string& from, const std::string& to) {
+    std::error_code ec;
+    std::filesystem::rename(from, to, ec);
+    if (ec) {
+        std::filesystem::remove(from, ec);
+        return false;
+    }
+    return true;
+}
+
 bool file_exists(const std::string& filename) {
     return std::filesystem::exists(filename) && std::filesystem::is_regular_file(filename);
 }
@@ -53,23 +102,395 @@ std::vector<std::string> list_files(const std::string& directory) {
     return files;
 }
 
-std::string sha1_hash(const std::string& input) {
-    unsigned char hash[SHA_DIGEST_LENGTH];
-    SHA_CTX sha1;
-    SHA1_Init(&sha1);
-    SHA1_Update(&sha1, input.c_str(), input.length());
-    SHA1_Final(hash, &sha1);
+std::uintmax_t file_size(const std::string& filename) {
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(filename, ec);
+    return ec ? 0 : size;
+}
+
+// Inode number of a file, used to order reads by on-disk location. Returns 0
+// where inodes are unavailable or the file does not exist.
+std::uint64_t file_inode(const std::string& filename) {
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(filename.c_str(), &st) == 0) {
+        return static_cast<std::uint64_t>(st.st_ino);
+    }
+#else
+    (void)filename;
+#endif
+    return 0;
+}
+
+std::string read_file_range(const std::string& filename, std::uintmax_t offset, size_t length) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return "";
+    }
+    
+    file.seekg(static_cast<std::streamoff>(offset));
+    std::string buffer(length, '\0');
+    file.read(buffer.data(), static_cast<std::streamsize>(length));
+    buffer.resize(static_cast<size_t>(file.gcount()));
+    return buffer;
+}
+
+// Hashes the file in fixed-size chunks so memory use does not grow with
+// the file.
+std::string hash_file(const EVP_MD* algorithm, const std::string& filename, const std::string& header) {
+    return hash_copy_file(algorithm, filename, "", header);
+}
+
+std::string hash_copy_file(const EVP_MD* algorithm, const std::string& from, const std::string& to,
+                           const std::string& header) {
+    std::ifstream file(from, std::ios::binary);
+    if (!file.is_open()) {
+        return "";
+    }
+    std::ofstream copy;
+    if (!to.empty()) {
+        copy.open(to, std::ios::binary | std::ios::trunc);
+        if (!copy.is_open()) {
+            return "";
+        }
+    }
+    
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    EVP_DigestInit_ex(context.get(), algorithm, nullptr);
+    EVP_DigestUpdate(context.get(), header.data(), header.size());
+    std::vector<char> chunk(1 << 20);
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        EVP_DigestUpdate(context.get(), chunk.data(), static_cast<size_t>(file.gcount()));
+        if (copy.is_open()) {
+            copy.write(chunk.data(), file.gcount());
+        }
+    }
+    if (file.bad()) {
+        return "";
+    }
+    if (copy.is_open()) {
+        copy.close();
+        if (!copy) {
+            return "";
+        }
+    }
     
-    return hex_encode(hash, SHA_DIGEST_LENGTH);
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_DigestFinal_ex(context.get(), hash, &length);
+    return hex_encode(hash, length);
+}
+
+std::string object_header(const std::string& type, size_t length) {
+    std::string header = type + " " + std::to_string(length);
+    header.push_back('\0');
+    return header;
+}
+
+std::string hash_object(const EVP_MD* algorithm, const std::string& type, const std::string& payload) {
+    std::string header = object_header(type, payload.size());
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    EVP_DigestInit_ex(context.get(), algorithm, nullptr);
+    EVP_DigestUpdate(context.get(), header.data(), header.size());
+    EVP_DigestUpdate(context.get(), payload.data(), payload.size());
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_DigestFinal_ex(context.get(), hash, &length);
+    return hex_encode(hash, length);
+}
+
+bool hex_decode(const std::string& hex, unsigned char* out) {
+    return hex.size() % 2 == 0 && cpu::kernels().hex_decode(hex.data(), hex.size() / 2, out);
+}
+
+HashStream::Buffer::Buffer(const EVP_MD* algorithm) : ctx(EVP_MD_CTX_new()) {
+    EVP_DigestInit_ex(ctx, algorithm, nullptr);
+}
+
+HashStream::Buffer::~Buffer() {
+    EVP_MD_CTX_free(ctx);
+}
+
+HashStream::Buffer::int_type HashStream::Buffer::overflow(int_type ch) {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        char c = traits_type::to_char_type(ch);
+        EVP_DigestUpdate(ctx, &c, 1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize HashStream::Buffer::xsputn(const char* s, std::streamsize n) {
+    EVP_DigestUpdate(ctx, s, static_cast<size_t>(n));
+    return n;
+}
+
+HashStream::HashStream(const EVP_MD* algorithm, const std::string& header)
+    : std::ostream(nullptr), buffer(algorithm) {
+    rdbuf(&buffer);
+    EVP_DigestUpdate(buffer.ctx, header.data(), header.size());
+}
+
+std::string HashStream::hex_digest() {
+    flush();
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_DigestFinal_ex(buffer.ctx, hash, &length);
+    return hex_encode(hash, length);
 }
 
 std::string hex_encode(const unsigned char* data, size_t length) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (size_t i = 0; i < length; ++i) {
-        ss << std::setw(2) << static_cast<int>(data[i]);
+    std::string out(2 * length, '\0');
+    cpu::kernels().hex_encode(data, length, out.data());
+    return out;
+}
+
+std::string compress(const std::string& data, int level) {
+    uLongf bound = compressBound(static_cast<uLong>(data.size()));
+    std::string out(bound, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(out.data()), &bound,
+                  reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()),
+                  level) != Z_OK) {
+        return "";
     }
-    return ss.str();
+    out.resize(bound);
+    return out;
+}
+
+std::string compress(const std::string& data, int level, const std::string& dictionary) {
+    z_stream stream{};
+    if (deflateInit(&stream, level) != Z_OK) {
+        return "";
+    }
+    if (deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             static_cast<uInt>(dictionary.size())) != Z_OK) {
+        deflateEnd(&stream);
+        return "";
+    }
+
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        return "";
+    }
+    out.resize(stream.total_out);
+    return out;
+}
+
+std::string decompress(const std::string& data) {
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        return "";
+    }
+    
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    
+    std::string out;
+    char chunk[16384];
+    int status;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(chunk);
+        stream.avail_out = sizeof(chunk);
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            inflateEnd(&stream);
+            return "";
+        }
+        out.append(chunk, sizeof(chunk) - stream.avail_out);
+    } while (status != Z_STREAM_END);
+    
+    inflateEnd(&stream);
+    return out;
+}
+
+// Every object type starts with a lowercase ASCII word, none of them with
+// 'x' (0x78), which is how a zlib stream starts. The header checksum makes
+// the test exact.
+bool is_compressed(const std::string& data) {
+    if (data.size() < 2 || static_cast<unsigned char>(data[0]) != 0x78) {
+        return false;
+    }
+    unsigned header = static_cast<unsigned char>(data[0]) * 256u + static_cast<unsigned char>(data[1]);
+    return header % 31 == 0;
+}
+
+std::string decompress(const unsigned char* data, size_t length, size_t expected_size,
+                       const std::string& dictionary) {
+    // Deflate expands at most 1032:1; a larger claimed size is a corrupt
+    // header and must not size the buffer
+    constexpr size_t MAX_INFLATE_RATIO = 1032;
+    if (expected_size / MAX_INFLATE_RATIO > length || expected_size > std::string().max_size()) {
+        return "";
+    }
+    std::string out(expected_size, '\0');
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        return "";
+    }
+    
+    // zlib counts in uInt, so feed and drain at most that much per call
+    const size_t step = std::numeric_limits<uInt>::max();
+    size_t in_left = length;
+    size_t out_left = expected_size;
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (stream.avail_in == 0) {
+            stream.avail_in = static_cast<uInt>(std::min(in_left, step));
+            in_left -= stream.avail_in;
+        }
+        if (stream.avail_out == 0) {
+            stream.avail_out = static_cast<uInt>(std::min(out_left, step));
+            out_left -= stream.avail_out;
+        }
+        status = inflate(&stream, Z_NO_FLUSH);
+        // The stream names its dictionary by checksum; a wrong one is refused
+        if (status == Z_NEED_DICT && !dictionary.empty() &&
+            inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()),
+                                 static_cast<uInt>(dictionary.size())) == Z_OK) {
+            status = Z_OK;
+        }
+        // Stalled on a chunk boundary; with nothing left to refill the
+        // stream is truncated or larger than its header claims
+        bool refill = (stream.avail_in == 0 && in_left > 0) || (stream.avail_out == 0 && out_left > 0);
+        if (status == Z_BUF_ERROR && refill) {
+            status = Z_OK;
+        }
+    }
+    inflateEnd(&stream);
+    
+    if (status != Z_STREAM_END || stream.total_out != expected_size) {
+        return "";
+    }
+    return out;
+}
+
+std::string decompress_prefix(const unsigned char* data, size_t length, size_t limit,
+                              const std::string& dictionary) {
+    std::string out(limit, '\0');
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        return "";
+    }
+    
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(length);
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(limit);
+    int status = inflate(&stream, Z_SYNC_FLUSH);
+    if (status == Z_NEED_DICT && !dictionary.empty() &&
+        inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             static_cast<uInt>(dictionary.size())) == Z_OK) {
+        status = inflate(&stream, Z_SYNC_FLUSH);
+    }
+    inflateEnd(&stream);
+    
+    // Z_BUF_ERROR: the output filled up or the input ran out, both expected
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+        return "";
+    }
+    out.resize(stream.total_out);
+    return out;
+}
+
+void put_be32(std::string& out, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void put_be64(std::string& out, std::uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+std::uint32_t get_be32(const unsigned char* data) {
+    return (static_cast<std::uint32_t>(data[0]) << 24) | (static_cast<std::uint32_t>(data[1]) << 16) |
+           (static_cast<std::uint32_t>(data[2]) << 8) | static_cast<std::uint32_t>(data[3]);
+}
+
+std::uint64_t get_be64(const unsigned char* data) {
+    return (static_cast<std::uint64_t>(get_be32(data)) << 32) | get_be32(data + 4);
+}
+
+// Seven bits per byte, least significant group first; the high bit marks
+// that another byte follows.
+void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t get_varint(const unsigned char* data, const unsigned char* end, std::uint64_t& value) {
+    value = 0;
+    int shift = 0;
+    for (const unsigned char* p = data; p < end && shift < 64; ++p, shift += 7) {
+        value |= static_cast<std::uint64_t>(*p & 0x7f) << shift;
+        if (!(*p & 0x80)) {
+            return static_cast<size_t>(p - data) + 1;
+        }
+    }
+    return 0;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    mapping = map;
+    bytes = static_cast<const unsigned char*>(map);
+    length = static_cast<size_t>(st.st_size);
+#else
+    if (!file_exists(filename)) {
+        return false;
+    }
+    fallback = read_file(filename);
+    if (fallback.empty()) {
+        return false;
+    }
+    bytes = reinterpret_cast<const unsigned char*>(fallback.data());
+    length = fallback.size();
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapping) {
+        ::munmap(mapping, length);
+    }
+#endif
+    mapping = nullptr;
+    bytes = nullptr;
+    length = 0;
+    fallback.clear();
 }
 
 std::vector<std::string> split(const std::string& str, char delimiter) {
@@ -167,20 +588,60 @@ std::string apply_patch(const std::string& content, const std::vector<std::strin
     return join(result, "\n");
 }
 
+#ifndef _WIN32
+namespace {
+
+// Only async-signal-safe operations in the handler: a lock-free flag and
+// sem_post, which wakes the thread that runs the callback
+std::atomic<bool> interrupted{false};
+sem_t interrupt_posted;
+
+extern "C" void handle_interrupt(int) {
+    if (interrupted.exchange(true)) {
+        std::_Exit(130);
+    }
+    sem_post(&interrupt_posted);
+}
+
+} // namespace
+
+void on_interrupt(std::function<void()> callback) {
+    sem_init(&interrupt_posted, 0, 0);
+    std::thread([callback = std::move(callback)] {
+        while (sem_wait(&interrupt_posted) != 0) {
+        }
+        callback();
+    }).detach();
+
+    struct sigaction action = {};
+    action.sa_handler = handle_interrupt;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+}
+#else
+// Without POSIX signals SIGINT keeps its default behaviour
+void on_interrupt(std::function<void()>) {
+}
+#endif
+
 void print_success(const std::string& message) {
     std::cout << "\033[32m✓ " << message << "\033[0m" << std::endl;
 }
 
 void print_error(const std::string& message) {
-    std::cout << "\033[31m✗ " << message << "\033[0m" << std::endl;
+    std::cerr << "\033[31m✗ " << message << "\033[0m" << std::endl;
 }
 
 void print_warning(const std::string& message) {
-    std::cout << "\033[33m⚠ " << message << "\033[0m" << std::endl;
+    std::cerr << "\033[33m⚠ " << message << "\033[0m" << std::endl;
 }
 
 void print_info(const std::string& message) {
     std::cout << "\033[34mℹ " << message << "\033[0m" << std::endl;
 }
 
+void report_error(const std::string& message) {
+    std::cerr << "error: " << message << std::endl;
+}
+
 } // namespace utils 
\ No newline at end of file
@@ -0,0 +1,166 @@
+// cat-file --batch-check answers from object headers without reading whole
+// objects. Its type and size must match what --batch reports after reading
+// the full object, for loose objects stored plain and compressed, large
+// file stubs, and packed objects including deltas. Ids that are absent or
+// malformed are answered "missing" in place.
+#include "minigit.h"
+#include "pack_store.h"
+#include "utils.h"
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::string all_ids() {
+    MiniGit git;
+    std::ostringstream out;
+    git.rev_list({"--all"}, true, out);
+    std::string ids;
+    std::istringstream lines(out.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+        ids += line.substr(0, line.find(' ')) + "\n";
+    }
+    return ids;
+}
+
+std::string batch(bool contents, const std::string& ids) {
+    MiniGit git;
+    std::istringstream in(ids);
+    std::ostringstream out;
+    git.cat_file_batch(contents, in, out);
+    return out.str();
+}
+
+// The header lines of --batch output, checking that each is followed by
+// exactly `size` bytes of content
+std::string headers(const std::string& output, bool& sizes_match) {
+    std::string result;
+    sizes_match = true;
+    size_t position = 0;
+    while (position < output.size()) {
+        size_t end = output.find('\n', position);
+        std::string header = output.substr(position, end - position);
+        result += header + "\n";
+        size_t size = std::stoull(header.substr(header.rfind(' ') + 1));
+        position = end + 1 + size;
+        sizes_match = sizes_match && position < output.size() && output[position] == '\n';
+        ++position;
+    }
+    return result;
+}
+
+void check_info_matches(const std::string& what) {
+    std::string ids = all_ids();
+    std::string quick = batch(false, ids);
+    bool sizes_match = false;
+    check(!ids.empty() && quick.find("missing") == std::string::npos, what + ": every object is found");
+    check(quick == headers(batch(true, ids), sizes_match), what + ": header lookup matches a full read");
+    check(sizes_match, what + ": the content has the size reported");
+}
+
+size_t delta_entries() {
+    PackStore store(".minigit/objects/pack", 1 << 16, 1 << 20, 1 << 20);
+    store.load();
+    size_t count = 0;
+    for (const auto& pack : store.get_packs()) {
+        std::string bytes = utils::read_file(".minigit/objects/pack/" + pack->get_name() + ".pack");
+        const auto& index = pack->get_index();
+        for (std::uint32_t i = 0; i < index.size(); ++i) {
+            count += static_cast<ObjectType>(bytes[index.offset_at(i)]) == ObjectType::OfsDelta ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+std::string document(int version) {
+    std::string text;
+    for (int line = 0; line < 200; ++line) {
+        text += "line " + std::to_string(line) + (line == 100 ? " edited " + std::to_string(version) : "") + "\n";
+    }
+    return text;
+}
+
+void commit_file(const std::string& name, const std::string& content) {
+    MiniGit git;
+    utils::write_file(name, content);
+    check(git.add(name) && git.commit("write " + name), "commit " + name);
+}
+
+void test_object_info() {
+    {
+        MiniGit git;
+        check(git.init(), "init a repository");
+        check(git.config_value("core.bigFileThreshold", "20000"), "lower the large file threshold");
+    }
+    commit_file("doc.txt", document(1));
+    check_info_matches("plain loose objects");
+
+    MiniGit(".").config_value("core.compression", "6");
+    commit_file("doc.txt", document(2));
+    commit_file("big.bin", std::string(30000, 'b'));
+    check(batch(false, all_ids()).find(" large 30000\n") != std::string::npos, "big.bin is stored as a large file");
+    check_info_matches("compressed loose objects and a large file");
+
+    {
+        MiniGit git;
+        check(git.repack(), "repack");
+    }
+    check(delta_entries() > 0, "the pack holds a delta");
+    check_info_matches("packed objects");
+}
+
+void test_batch() {
+    std::string content = document(1);
+    std::string object = "blob " + std::to_string(content.size()) + std::string(1, '\0') + content;
+    unsigned char digest[Sha1Policy::DIGEST_SIZE];
+    HashContext<Sha1Policy>::digest(object.data(), object.size(), digest);
+    std::string id = utils::hex_encode(digest, Sha1Policy::DIGEST_SIZE);
+    std::string absent(40, '0');
+    std::string request = absent + "\n" + id + "\nnot-an-id\n" + id + "\n";
+
+    std::string header = id + " blob " + std::to_string(content.size()) + "\n";
+    check(batch(false, request) == absent + " missing\n" + header + "not-an-id missing\n" + header,
+          "batch-check answers each line in order");
+    check(batch(true, request) == absent + " missing\n" + header + content + "\nnot-an-id missing\n" + header +
+                                      content + "\n",
+          "batch writes each object's content after its header");
+    check(batch(false, "").empty(), "no input, no output");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-cat-file-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::current_path(root);
+
+    test_object_info();
+    test_batch();
+
+    std::filesystem::current_path(start);
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Integer config values: plain numbers, k/m/g suffixes, and everything that
+// must fall back to the default instead of being half-parsed or overflowing.
+#include "config.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::int64_t read_int(const std::string& value) {
+    Config config;
+    config.set("core.value", value);
+    return config.get_int("core.value", -7);
+}
+
+} // namespace
+
+int main() {
+    check(read_int("42") == 42, "plain number");
+    check(read_int("-3") == -3, "negative number");
+    check(read_int("4k") == 4096, "k suffix");
+    check(read_int("512m") == (std::int64_t{512} << 20), "m suffix");
+    check(read_int("2G") == (std::int64_t{2} << 30), "upper-case G suffix");
+    check(read_int("-1k") == -1024, "negative with suffix");
+    check(read_int("8589934591g") == std::int64_t{8589934591} * (std::int64_t{1} << 30), "largest g value");
+
+    for (const char* bad : {"", "k", "4kb", "1gx", "12 ", "0x10", "3t", "abc",
+                                   "8589934592g", "-8589934592g", "99999999999999999999"}) {
+        check(read_int(bad) == -7, "'" + std::string(bad) + "' reads as the default");
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,239 @@
+// Deltas as stored in packs: each one built by delta::Index must rebuild
+// its target through apply and, a prefix at a time, through apply_prefix.
+// Targets are random, edited copies of the base (insertions, deletions,
+// overwrites) and a base repeated past the 0x10000 copy size. Damaged
+// deltas must be refused rather than read out of bounds. PackBuilder's
+// search must find deltas between versions of a file, and every object in
+// the pack it writes must read back.
+#include "delta.h"
+#include "pack_builder.h"
+#include "pack_store.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::string random_bytes(std::mt19937& random, size_t length) {
+    std::string bytes(length, '\0');
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random() & 0xff);
+    }
+    return bytes;
+}
+
+// A handful of insertions, deletions and overwrites at random places
+std::string edit(std::mt19937& random, std::string text) {
+    for (int i = 0; i < 8 && !text.empty(); ++i) {
+        size_t at = random() % text.size();
+        size_t length = std::min<size_t>(random() % 200, text.size() - at);
+        switch (random() % 3) {
+        case 0: text.insert(at, random_bytes(random, length)); break;
+        case 1: text.erase(at, length); break;
+        default: text.replace(at, length, random_bytes(random, length)); break;
+        }
+    }
+    return text;
+}
+
+void check_round_trip(const std::string& base, const std::string& target, const std::string& what) {
+    delta::Index index(base);
+    std::string data = index.create(target, SIZE_MAX);
+    std::string out;
+    check(!data.empty() && delta::apply(base, data, out) && out == target, what + " round trip");
+
+    for (size_t length : {size_t{0}, size_t{1}, size_t{100}, target.size() / 2, target.size() + 10}) {
+        std::string prefix;
+        size_t base_needed = 1;
+        bool ok = delta::apply_prefix(base, data, length, prefix, base_needed);
+        check(ok && base_needed == 0 && prefix == target.substr(0, length),
+              what + " prefix of " + std::to_string(length));
+    }
+}
+
+void test_round_trips() {
+    std::mt19937 random(3);
+    for (size_t size : {size_t{0}, size_t{15}, size_t{16}, size_t{1000}, size_t{70000}}) {
+        std::string base = random_bytes(random, size);
+        std::string at = " of size " + std::to_string(size);
+        check_round_trip(base, base, "identical" + at);
+        check_round_trip(base, edit(random, base), "edited" + at);
+        check_round_trip(base, random_bytes(random, size + 5), "unrelated" + at);
+    }
+    // Copies longer than 0x10000 are split across instructions
+    std::string block = random_bytes(random, 40000);
+    check_round_trip(block + block, block + block + block + block, "long copies");
+    check_round_trip("", random_bytes(random, 300), "empty base");
+}
+
+void test_limits() {
+    std::mt19937 random(4);
+    std::string base = random_bytes(random, 4096);
+    delta::Index index(base);
+    check(index.create(random_bytes(random, 4096), 100).empty(), "delta over max_size is dropped");
+    check(!index.create(edit(random, base), 1000).empty(), "small delta within max_size is kept");
+
+    // A prefix whose copies reach past a truncated base names what it needs
+    std::string data = index.create(base, SIZE_MAX);
+    std::string out;
+    size_t base_needed = 0;
+    check(!delta::apply_prefix(base.substr(0, 100), data, 2000, out, base_needed) && base_needed >= 2000,
+          "short base reports the length it needs");
+}
+
+void test_corrupt() {
+    std::mt19937 random(5);
+    std::string base = random_bytes(random, 2000);
+    std::string target = edit(random, base);
+    std::string data = delta::Index(base).create(target, SIZE_MAX);
+    std::string out;
+
+    check(!delta::apply(base.substr(1), data, out), "reject base of the wrong size");
+    check(!delta::apply(base, "", out), "reject empty delta");
+    check(!delta::apply(base, data.substr(0, data.size() - 1), out), "reject truncated delta");
+    check(!delta::apply(base, data + '\x01', out), "reject delta longer than its result");
+    // A result size near 2^62 must be refused, not reserved
+    check(!delta::apply(base, std::string("\xd0\x0f") + std::string(8, '\xff') + '\x3f' + "\x90\x05", out),
+          "reject oversized result");
+
+    // Sizes 2000 and 5, then each bad instruction on its own. A prefix
+    // stops once it has its bytes, so it cannot see overlong results.
+    struct Corrupt {
+        const char* what;
+        std::string delta;
+        bool in_prefix;
+    };
+    const std::string header = "\xd0\x0f\x05";
+    const std::vector<Corrupt> corrupt = {
+        {"reserved opcode 0", header + std::string(1, '\0'), true},
+        {"copy past the base", header + "\x93\xff\x0f\x05", true},
+        {"copy past the result", header + "\x90\x06", false},
+        {"literal past the result", header + "\x06" + "abcdef", false},
+        {"literal past the delta", header + "\x05" + "ab", true},
+        {"copy arguments past the delta", header + "\x93\x01", true},
+        {"unterminated size", "\xd0", true},
+    };
+    for (const auto& [what, bad, in_prefix] : corrupt) {
+        size_t base_needed = 0;
+        check(!delta::apply(base, bad, out), std::string("reject ") + what);
+        if (in_prefix) {
+            check(!delta::apply_prefix(base, bad, 5, out, base_needed), std::string("prefix rejects ") + what);
+        }
+    }
+    check(delta::apply(base, header + "\x90\x05", out) && out == base.substr(0, 5), "well-formed copy applies");
+}
+
+// Builds a pack from `objects` (serialized, by id) with `options`;
+// returns its name and the number of deltas it holds
+using Objects = std::map<std::string, std::string>;
+
+std::pair<std::string, size_t> build_pack(const std::string& dir, const Objects& objects, const Objects& paths,
+                                          const PackBuilder::Options& options) {
+    PackBuilder builder(dir, options);
+    for (const auto& [id, data] : objects) {
+        PackBuilder::Object object;
+        object.hash = id;
+        object.type = object_type_of(data);
+        object.size = data.size();
+        object.path_hash = PackBuilder::path_hash(paths.at(id));
+        builder.add(object);
+    }
+    std::string name = builder.write(
+        [&](const std::string& id) { return objects.at(id); },
+        [](const std::string&, std::string&) { return false; });
+    return {name, builder.delta_count()};
+}
+
+void test_pack_builder(const std::string& root) {
+    std::mt19937 random(6);
+    Objects objects;
+    Objects paths; // id -> path
+    auto add = [&](const std::string& content, const std::string& path) {
+        std::string id = utils::hash_object(EVP_sha1(), "blob", content);
+        objects[id] = "blob " + std::to_string(content.size()) + "\n" + content;
+        paths[id] = path;
+    };
+    // Twenty versions of each of two files, some unrelated data, and
+    // objects too small to delta
+    for (const std::string path : {"src/a.cpp", "docs/b.md"}) {
+        std::string content = random_bytes(random, 6000);
+        for (int version = 0; version < 20; ++version) {
+            add(content, path);
+            content = edit(random, content);
+        }
+    }
+    for (int i = 0; i < 5; ++i) {
+        add(random_bytes(random, 3000), "data/" + std::to_string(i) + ".bin");
+        add(random_bytes(random, 20), "tiny/" + std::to_string(i));
+    }
+
+    PackBuilder::Options options;
+    std::string dir = root + "/pack";
+    auto [name, deltas] = build_pack(dir, objects, paths, options);
+    check(!name.empty(), "PackBuilder writes a pack");
+    check(deltas >= 30 && deltas <= 38,
+          "versions are stored as deltas, nothing else (" + std::to_string(deltas) + ")");
+    check(build_pack(dir, objects, paths, options).first == name, "the same objects give the same pack");
+
+    PackStore store(dir, 1 << 20, 1 << 24, 1 << 20);
+    store.load();
+    bool all_read = true;
+    for (const auto& [id, data] : objects) {
+        all_read = all_read && store.read(id) == data;
+    }
+    check(all_read, "every object reads back through its delta chain");
+
+    // Chains capped at one delta each still read back; no window means no
+    // deltas
+    options.depth = 1;
+    auto [shallow, shallow_deltas] = build_pack(root + "/shallow", objects, paths, options);
+    check(!shallow.empty() && shallow_deltas > 0 && shallow_deltas < deltas, "depth 1 keeps some deltas");
+    PackStore shallow_store(root + "/shallow", 1 << 20, 1 << 24, 1 << 20);
+    shallow_store.load();
+    all_read = true;
+    for (const auto& [id, data] : objects) {
+        all_read = all_read && shallow_store.read(id) == data;
+    }
+    check(all_read, "every object reads back at depth 1");
+    options.window = 0;
+    check(build_pack(root + "/plain", objects, paths, options).second == 0, "window 0 stores no deltas");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-delta-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+
+    test_round_trips();
+    test_limits();
+    test_corrupt();
+    test_pack_builder(root);
+
+    std::filesystem::remove_all(root);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
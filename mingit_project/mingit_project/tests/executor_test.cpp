@@ -0,0 +1,100 @@
+// Cancellation of parallel work: for_each_bounded and parallel_for must
+// stop starting items once a stop is requested and report it, and a SIGINT
+// routed through utils::on_interrupt must request that stop.
+#include "executor.h"
+#include "task.h"
+#include "utils.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+// Waits up to a few seconds for the interrupt thread to act
+bool wait_for_stop(const std::stop_token& stop) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!stop.stop_requested() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return stop.stop_requested();
+}
+
+void test_for_each_bounded(Executor& executor) {
+    std::atomic<size_t> ran{0};
+    check(for_each_bounded(executor, 100, 4, [&](size_t) -> Task<> {
+        ++ran;
+        co_return;
+    }), "uncancelled run completes");
+    check(ran == 100, "every item runs");
+
+    // With one slot the items run in order, so the stop lands after item 3
+    std::stop_source source;
+    ran = 0;
+    bool completed = for_each_bounded(executor, 100, 1, [&](size_t i) -> Task<> {
+        ++ran;
+        if (i == 3) {
+            source.request_stop();
+        }
+        co_return;
+    }, source.get_token());
+    check(!completed, "cancelled run reports it");
+    check(ran == 4, "no item starts after the stop");
+}
+
+void test_parallel_for(Executor& executor) {
+    std::stop_source source;
+    source.request_stop();
+    std::atomic<size_t> ran{0};
+    check(!executor.parallel_for(50, [&](size_t) { ++ran; }, source.get_token()), "stopped parallel_for reports it");
+    check(ran == 0, "stopped parallel_for runs nothing");
+}
+
+void test_interrupt(Executor& executor) {
+#ifndef _WIN32
+    std::stop_source source;
+    utils::on_interrupt([source]() mutable { source.request_stop(); });
+    std::atomic<size_t> ran{0};
+    bool stopped = false;
+    bool completed = for_each_bounded(executor, 100, 1, [&](size_t i) -> Task<> {
+        ++ran;
+        if (i == 3) {
+            std::raise(SIGINT);
+            stopped = wait_for_stop(source.get_token());
+        }
+        co_return;
+    }, source.get_token());
+    check(stopped, "SIGINT requests a stop");
+    check(!completed && ran == 4, "SIGINT cancels a running for_each_bounded");
+#else
+    (void)executor;
+#endif
+}
+
+} // namespace
+
+int main() {
+    Executor executor(4);
+    test_for_each_bounded(executor);
+    test_parallel_for(executor);
+    test_interrupt(executor);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
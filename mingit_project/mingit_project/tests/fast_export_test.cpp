@@ -0,0 +1,107 @@
+// Exports a repository built with add, commit, branch and merge, imports
+// the stream into an empty repository, and checks that both hold the same
+// commit ids on every branch and that exporting the copy gives the same
+// stream again. A low core.bigFileThreshold sends one file through the
+// large-object store on both sides.
+#include "minigit.h"
+#include "utils.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+// Commands take paths relative to the working directory, as from the
+// command line
+void commit_files(MiniGit& git, const std::vector<std::pair<std::string, std::string>>& files,
+                  const std::string& message) {
+    std::vector<std::string> names;
+    for (const auto& [name, content] : files) {
+        utils::write_file(name, content);
+        names.push_back(name);
+    }
+    check(git.add(names) && git.commit(message), "commit " + message);
+}
+
+std::string rev_list(MiniGit& git, bool objects) {
+    std::ostringstream out;
+    git.rev_list({"--all"}, objects, out);
+    return out.str();
+}
+
+std::string export_all(MiniGit& git) {
+    std::ostringstream out;
+    check(git.fast_export({"--all"}, out), "export every branch");
+    return out.str();
+}
+
+void build_source(const std::string& dir) {
+    std::filesystem::current_path(dir);
+    MiniGit git;
+    check(git.init(), "init the source repository");
+    git.config_value("core.bigFileThreshold", "2k");
+
+    commit_files(git, {{"README", "hello\n"}, {"big.bin", std::string(5000, 'b')}}, "first");
+    commit_files(git, {{"README", "hello again\n"}, {"notes.txt", "notes\n"}}, "second");
+    check(git.branch("side") && git.checkout("side"), "switch to a new branch");
+    commit_files(git, {{"side.txt", "side\n"}}, "on side");
+    check(git.checkout("main"), "switch back to main");
+    commit_files(git, {{"notes.txt", "more notes\n"}}, "on main");
+    check(git.merge("side"), "merge side into main");
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::path root = std::filesystem::temp_directory_path() /
+                                 ("minigit-fast-export-test-" + std::to_string(std::time(nullptr)));
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "source");
+    std::filesystem::create_directories(root / "copy");
+
+    build_source((root / "source").string());
+    MiniGit source((root / "source").string());
+    std::string stream = export_all(source);
+    std::string commits = rev_list(source, false);
+    std::string objects = rev_list(source, true);
+    check(std::count(commits.begin(), commits.end(), '\n') == 5, "source has five commits");
+
+    std::filesystem::current_path(root / "copy");
+    {
+        MiniGit copy;
+        check(copy.init(), "init the copy");
+        copy.config_value("core.bigFileThreshold", "2k");
+        std::istringstream in(stream);
+        check(copy.fast_import(in), "import the exported stream");
+    }
+    MiniGit copy((root / "copy").string());
+    check(rev_list(copy, false) == commits, "the copy has the same commit ids");
+    check(rev_list(copy, true) == objects, "the copy has the same blobs at the same paths");
+    check(copy.get_branches() == source.get_branches(), "the copy has the same branches");
+    check(copy.get_head_commit() == source.get_head_commit(), "the copy has the same HEAD");
+    check(export_all(copy) == stream, "exporting the copy gives the same stream");
+    check(copy.fsck(), "fsck passes on the copy");
+
+    std::filesystem::current_path(start);
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,211 @@
+// Imports a fixed fast-import stream into a scratch repository and reads
+// the result back: marks, counted and delimited data, quoted paths with
+// octal escapes, from/merge, D and deleteall. Broken streams must fail
+// without moving a branch past the last checkpoint.
+#include "commit.h"
+#include "minigit.h"
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+const char* const STREAM = R"(feature done
+blob
+mark :1
+data 6
+hello
+
+blob
+mark :2
+data <<EOF
+second
+EOF
+commit refs/heads/main
+mark :10
+author A U Thor <a@example.com> 1700000000 +0000
+committer C O Mitter <c@example.com> 1700000100 +0000
+data 12
+first commit
+M 100644 :1 plain.txt
+M 100644 :2 "caf\303\251.txt"
+M 100644 inline "tab\tname"
+data 3
+abc
+# comments are skipped
+commit refs/heads/topic
+mark :11
+committer C O Mitter <c@example.com> 1700000200 +0000
+data 5
+topic
+from :10
+D plain.txt
+M 100644 :1 new.txt
+
+commit refs/heads/main
+committer C O Mitter <c@example.com> 1700000300 +0000
+data <<EOF
+merge
+topic
+EOF
+merge :11
+M 100644 :2 merged.txt
+
+reset refs/heads/clean
+from refs/heads/main
+commit refs/heads/clean
+committer C O Mitter <c@example.com> 1700000400 +0000
+data 5
+clean
+deleteall
+M 100644 :1 only.txt
+done
+)";
+
+// Object content as cat-file --batch prints it, or "" if missing
+std::string cat(MiniGit& git, const std::string& id) {
+    std::istringstream in(id + "\n");
+    std::ostringstream out;
+    git.cat_file_batch(true, in, out);
+    std::string text = out.str();
+    size_t header_end = text.find('\n');
+    if (header_end == std::string::npos || text.ends_with(" missing\n")) {
+        return "";
+    }
+    return text.substr(header_end + 1, text.size() - header_end - 2);
+}
+
+std::shared_ptr<Commit> tip(MiniGit& git, const std::string& branch) {
+    std::ostringstream out;
+    if (!git.rev_list({branch}, false, out)) {
+        return nullptr;
+    }
+    std::string hash = out.str().substr(0, out.str().find('\n'));
+    auto commit = Commit::from_string(cat(git, hash));
+    if (commit) {
+        commit->set_hash(hash);
+    }
+    return commit;
+}
+
+bool import(MiniGit& git, const std::string& stream) {
+    std::istringstream in(stream);
+    return git.fast_import(in);
+}
+
+void test_import(const std::string& root) {
+    MiniGit git(root);
+    check(git.init(), "init scratch repository");
+    check(import(git, STREAM), "import the fixture stream");
+
+    MiniGit reopened(root);
+    auto main = tip(reopened, "main");
+    auto topic = tip(reopened, "topic");
+    auto clean = tip(reopened, "clean");
+    if (!main || !topic || !clean) {
+        check(false, "every branch in the stream exists");
+        return;
+    }
+    check(reopened.get_head_commit() == main->get_hash(), "HEAD follows the current branch");
+
+    auto first = Commit::from_string(cat(reopened, topic->get_parents().at(0)));
+    check(first && first->get_message() == "first commit" && first->get_parents().empty(), "root commit");
+    check(first && first->get_author() == "A U Thor <a@example.com>", "author line names the author");
+    check(first && first->get_timestamp() == 1700000100, "committer time orders history");
+    if (first) {
+        const auto& files = first->get_files();
+        check(files.size() == 3, "root commit has three files");
+        check(files.count("plain.txt") && cat(reopened, files.at("plain.txt")) == "hello\n", "counted data");
+        check(files.count("caf\xc3\xa9.txt") && cat(reopened, files.at("caf\xc3\xa9.txt")) == "second\n",
+              "octal escapes and delimited data");
+        check(files.count("tab\tname") && cat(reopened, files.at("tab\tname")) == "abc", "inline data");
+    }
+
+    check(topic->get_author() == "C O Mitter <c@example.com>", "committer stands in for a missing author");
+    check(topic->get_files().count("new.txt") && !topic->get_files().count("plain.txt"), "M and D on a branch");
+
+    check(main->get_parents() == std::vector<std::string>{topic->get_parents().at(0), topic->get_hash()},
+          "merge adds a second parent to the branch tip");
+    check(main->get_message() == "merge topic", "multi-line message kept on one line");
+    check(main->get_files().count("merged.txt") && main->get_files().count("plain.txt"),
+          "merge commit starts from its first parent's files");
+
+    check(clean->get_parents() == std::vector<std::string>{main->get_hash()}, "reset from a branch");
+    check(clean->get_files().size() == 1 && clean->get_files().count("only.txt"), "deleteall clears the files");
+    check(reopened.fsck(), "fsck passes after the import");
+}
+
+void test_failures(const std::string& root) {
+    auto commit_on = [](const std::string& branch) {
+        return "commit refs/heads/" + branch + "\ncommitter C <c> 1700000500 +0000\ndata 1\nx\n";
+    };
+    const std::string commit = commit_on("main");
+    const std::vector<std::pair<std::string, std::string>> broken = {
+        {"unknown mark", commit + "from :99\n"},
+        {"unknown blob", commit + "M 100644 :42 file\n"},
+        {"bad octal escape", commit + "M 100644 inline \"a\\39\"\ndata 1\nx\n"},
+        {"bad escape", commit + "M 100644 inline \"a\\q\"\ndata 1\nx\n"},
+        {"unterminated path", commit + "M 100644 inline \"abc\ndata 1\nx\n"},
+        {"path with a space", commit + "M 100644 inline a b\ndata 1\nx\n"},
+        {"data past the end", "blob\ndata 100\nshort\n"},
+        {"unterminated data", "blob\ndata <<EOF\nnever closed\n"},
+        {"bad data length", "blob\ndata 12x\n"},
+        {"unsupported command", "tag v1\n"},
+    };
+
+    MiniGit git(root);
+    auto main = tip(git, "main");
+    if (!main) {
+        check(false, "main exists before the failing imports");
+        return;
+    }
+    std::string before = main->get_hash();
+    for (const auto& [what, stream] : broken) {
+        check(!import(git, stream), "reject " + what);
+    }
+    MiniGit reopened(root);
+    main = tip(reopened, "main");
+    check(main && main->get_hash() == before, "failed imports leave the branch alone");
+
+    // A checkpoint publishes what came before it, even if the stream fails
+    // later
+    std::string stream = "reset refs/heads/saved\nfrom refs/heads/main\n" + commit_on("saved") + "checkpoint\nbogus\n";
+    check(!import(reopened, stream), "stream failing after a checkpoint");
+    MiniGit after(root);
+    auto saved = tip(after, "saved");
+    check(saved && saved->get_parents() == std::vector<std::string>{before}, "checkpoint published the branch");
+    check(after.fsck(), "fsck passes after failed imports");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-fast-import-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    test_import(root);
+    test_failures(root);
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Runs each vector kernel the CPU supports on the same inputs as its
+// portable counterpart and compares the results: hex encode and decode
+// against the table-driven versions, sha1_multi lanes against OpenSSL one
+// input at a time. Lengths straddle the 16-byte hex step and the 64-byte
+// SHA-1 block, and include empty inputs and invalid digits.
+#include "cpu.h"
+#include "hex.h"
+#include "sha1_multi.h"
+#include "utils.h"
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::string random_bytes(std::mt19937& random, size_t length) {
+    std::string bytes(length, '\0');
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random() & 0xff);
+    }
+    return bytes;
+}
+
+std::string openssl_sha1(std::string_view input) {
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    EVP_Digest(input.data(), input.size(), digest, nullptr, EVP_sha1(), nullptr);
+    std::string hex(2 * SHA_DIGEST_LENGTH, '\0');
+    hex::encode_scalar(digest, SHA_DIGEST_LENGTH, hex.data());
+    return hex;
+}
+
+using Encode = void (*)(const unsigned char*, size_t, char*);
+using Decode = bool (*)(const char*, size_t, unsigned char*);
+
+void test_hex(const std::string& name, Encode encode, Decode decode) {
+    std::mt19937 random(1);
+    for (size_t length = 0; length <= 100; ++length) {
+        std::string bytes = random_bytes(random, length);
+        const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+        std::string expected(2 * length, '\0');
+        std::string actual(2 * length, '\0');
+        hex::encode_scalar(data, length, expected.data());
+        encode(data, length, actual.data());
+        std::string at = " at length " + std::to_string(length);
+        check(actual == expected, name + " encode" + at);
+
+        std::string upper = expected;
+        for (auto& c : upper) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        for (const std::string& digits : {expected, upper}) {
+            std::string decoded(length, '\0');
+            bool ok = decode(digits.data(), length, reinterpret_cast<unsigned char*>(decoded.data()));
+            check(ok && decoded == bytes, name + " decode" + at);
+        }
+
+        // One bad digit anywhere, in every class the range checks split on
+        for (size_t position = 0; position < expected.size(); ++position) {
+            for (char bad : {'g', 'G', '/', ':', '@', '`', ' ', '\0', '\x80'}) {
+                std::string digits = expected;
+                digits[position] = bad;
+                std::string scratch(length, '\0');
+                auto* out = reinterpret_cast<unsigned char*>(scratch.data());
+                check(!decode(digits.data(), length, out) && !hex::decode_scalar(digits.data(), length, out),
+                      name + " rejects " + std::to_string(static_cast<unsigned char>(bad)) + " at " +
+                          std::to_string(position) + at);
+            }
+        }
+    }
+}
+
+void test_sha1(const std::string& name, void (*compress)(sha1_multi::Lane*), size_t lanes) {
+    std::mt19937 random(2);
+    std::vector<std::string> inputs = {""};
+    for (size_t length : {1, 3, 15, 16, 17, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 129, 1000, 4097}) {
+        inputs.push_back(random_bytes(random, length));
+    }
+    for (size_t i = 0; i < 3 * lanes; ++i) {
+        inputs.push_back(random_bytes(random, random() % 300));
+    }
+    inputs.push_back("");
+
+    // Whole set (several groups, mixed lengths), then fewer inputs than lanes
+    for (size_t count : {inputs.size(), lanes - 1, size_t{1}}) {
+        std::vector<std::string_view> views(inputs.begin(), inputs.begin() + count);
+        std::vector<std::string> digests = sha1_multi::hash_with(compress, lanes, views);
+        check(digests.size() == count, name + " returns one digest per input");
+        for (size_t i = 0; i < digests.size(); ++i) {
+            check(digests[i] == openssl_sha1(views[i]),
+                  name + " input of length " + std::to_string(views[i].size()) + " in a group of " +
+                      std::to_string(count));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    // Whatever is bound must match the portable code too
+    test_hex("bound", cpu::kernels().hex_encode, cpu::kernels().hex_decode);
+    std::vector<std::string> sample = {"", "a", std::string(64, 'b'), std::string(200, 'c')};
+    std::vector<std::string> bound =
+        sha1_multi::hash(std::vector<std::string_view>(sample.begin(), sample.end()));
+    for (size_t i = 0; i < sample.size(); ++i) {
+        check(bound[i] == openssl_sha1(sample[i]), "bound sha1 of length " + std::to_string(sample[i].size()));
+    }
+
+#ifdef MINIGIT_HAVE_X86_SIMD
+    const cpu::Features& features = cpu::features();
+    if (features.avx2) {
+        test_hex("avx2", hex::encode_avx2, hex::decode_avx2);
+        test_sha1("avx2", sha1_multi::compress_avx2, 8);
+    } else {
+        std::cout << "AVX2 not available, skipped\n";
+    }
+    if (features.avx512f) {
+        test_sha1("avx512", sha1_multi::compress_avx512, 16);
+    } else {
+        std::cout << "AVX-512 not available, skipped\n";
+    }
+#endif
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,125 @@
+// maintenance run: with --auto a task runs only once its measure reaches
+// maintenance.<task>.auto, and 0 disables it. A held maintenance.lock makes
+// a plain run fail and an --auto run succeed without doing anything; a lock
+// older than an hour is broken.
+#include "minigit.h"
+#include "utils.h"
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+size_t loose_objects() {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(".minigit/objects")) {
+        count += entry.is_regular_file() && entry.path().filename().string().size() == 40 ? 1 : 0;
+    }
+    return count;
+}
+
+size_t packs() {
+    size_t count = 0;
+    if (std::filesystem::exists(".minigit/objects/pack")) {
+        for (const auto& entry : std::filesystem::directory_iterator(".minigit/objects/pack")) {
+            count += entry.path().extension() == ".pack" ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+bool has_commit_graph() {
+    return std::filesystem::exists(".minigit/objects/info/commit-graphs/commit-graph-chain");
+}
+
+void commit_file(const std::string& name, const std::string& content) {
+    MiniGit git;
+    utils::write_file(name, content);
+    check(git.add(name) && git.commit("add " + name), "commit " + name);
+}
+
+// Settings are read when a repository is opened, so each run gets a fresh one
+bool run(const std::string& key, const std::string& value, bool auto_only) {
+    if (!key.empty()) {
+        MiniGit(".").config_value(key, value);
+    }
+    MiniGit git;
+    return git.maintenance("run", "", auto_only);
+}
+
+void test_auto_thresholds() {
+    {
+        MiniGit git;
+        check(git.init(), "init a repository");
+        // Leave the commit-graph to the maintenance task
+        check(git.config_value("commitGraph.writeOnCommit", "false"), "stop commits writing the commit-graph");
+    }
+    commit_file("a.txt", "a\n");
+    commit_file("b.txt", "b\n");
+    commit_file("c.txt", "c\n");
+    size_t loose = loose_objects();
+
+    check(run("", "", true), "auto run below the default thresholds");
+    check(!has_commit_graph() && packs() == 0 && loose_objects() == loose, "no task is due by default");
+
+    MiniGit(".").config_value("maintenance.loose-objects.auto", "0");
+    check(run("maintenance.commit-graph.auto", "3", true), "auto run at the commit-graph threshold");
+    check(has_commit_graph(), "commit-graph runs once three commits are outside it");
+    check(packs() == 0 && loose_objects() == loose, "loose-objects.auto=0 disables the task");
+
+    check(run("maintenance.loose-objects.auto", std::to_string(loose + 1), true), "auto run below loose threshold");
+    check(packs() == 0, "loose-objects waits for its threshold");
+    check(run("maintenance.loose-objects.auto", std::to_string(loose), true), "auto run at the loose threshold");
+    check(packs() == 1 && loose_objects() == 0, "loose-objects packs the loose objects");
+}
+
+void test_lock() {
+    const std::string lock = ".minigit/maintenance.lock";
+    commit_file("d.txt", "d\n");
+    MiniGit(".").config_value("maintenance.loose-objects.auto", "1");
+    size_t loose = loose_objects();
+
+    utils::write_file(lock, std::to_string(std::time(nullptr)) + "\n");
+    check(!run("", "", false), "a held lock makes run fail");
+    check(run("", "", true), "a held lock makes an auto run succeed");
+    check(loose_objects() == loose && utils::file_exists(lock), "nothing runs and the lock is left alone");
+
+    utils::write_file(lock, std::to_string(std::time(nullptr) - 2 * 3600) + "\n");
+    check(run("", "", true), "auto run with a stale lock");
+    check(loose_objects() == 0, "a stale lock is broken and the tasks run");
+    check(!utils::file_exists(lock), "the lock is released after the run");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-maintenance-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::current_path(root);
+
+    test_auto_thresholds();
+    test_lock();
+
+    std::filesystem::current_path(start);
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
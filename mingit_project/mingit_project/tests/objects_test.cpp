@@ -0,0 +1,139 @@
+// Parsing of stored commits and blobs, and fsck on objects that do not
+// parse: a corrupt object must read as nullptr and be reported, never
+// throw. A damaged commit-graph must likewise fail to open.
+#include "blob.h"
+#include "commit.h"
+#include "commit_graph.h"
+#include "minigit.h"
+#include "utils.h"
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+const std::string ID_A(40, 'a');
+const std::string ID_B(40, 'b');
+
+std::string commit_text(const std::string& timestamp, const std::string& parents, const std::string& files) {
+    return "commit " + ID_A + "\nmessage m\nauthor a\ntimestamp " + timestamp + "\nparents " + parents + "\n" +
+           files;
+}
+
+void test_commit_parsing() {
+    Commit commit("message", "author");
+    commit.add_parent(ID_A);
+    commit.add_file("f.txt", ID_B);
+    commit.set_hash(commit.compute_hash<Sha1Policy>());
+    auto parsed = Commit::from_string(commit.to_string());
+    check(parsed && parsed->get_hash() == commit.get_hash() && parsed->compute_hash<Sha1Policy>() == commit.get_hash(),
+          "commit round trip keeps its id");
+    check(parsed && parsed->get_parents() == std::vector<std::string>{ID_A}, "commit round trip keeps parents");
+    check(parsed && parsed->get_files().at("f.txt") == ID_B, "commit round trip keeps files");
+
+    const std::vector<std::pair<std::string, std::string>> corrupt = {
+        {"parents zz", commit_text("1", "zz", "files 0\n")},
+        {"negative parents", commit_text("1", "-1", "files 0\n")},
+        {"parents past the end", commit_text("1", "3", "parent " + ID_B + "\n")},
+        {"parent line missing", commit_text("1", "1", "files 0\n")},
+        {"files zz", commit_text("1", "0", "files zz\n")},
+        {"timestamp junk", commit_text("soon", "0", "files 0\n")},
+        {"overflowing count", commit_text("1", "99999999999999999999999", "files 0\n")},
+        {"truncated", "commit " + ID_A + "\nmessage m\n"},
+    };
+    for (const auto& [what, text] : corrupt) {
+        check(Commit::from_string(text) == nullptr, "reject commit with " + what);
+    }
+}
+
+void test_blob_parsing() {
+    auto blob = Blob::from_string("blob 5\nhello", ID_A);
+    check(blob && blob->get_content() == "hello" && blob->get_hash() == ID_A, "blob keeps content and id");
+    check(Blob::from_string("blob 9\nhello", ID_A) == nullptr, "reject blob with a wrong length");
+    check(Blob::from_string("blob x\nhello", ID_A) == nullptr, "reject blob with a bad length");
+    check(Blob::from_string("large 99999999999999999999999\n", ID_A) == nullptr, "reject overflowing large size");
+    auto large = Blob::from_string("large 42\n", ID_A);
+    check(large && large->is_large() && large->size() == 42, "large stub keeps its size");
+}
+
+void test_fsck_reports_corrupt_commit(const std::string& root) {
+    std::filesystem::create_directories(root);
+    {
+        MiniGit git(root);
+        check(git.init(), "init scratch repository");
+        check(git.fsck(), "fsck passes on an empty repository");
+    }
+    utils::write_file(root + "/.minigit/objects/" + ID_A, commit_text("1", "zz", "files 0\n"));
+    MiniGit git(root);
+    check(!git.fsck(), "fsck reports a commit with an unparsable parent count");
+}
+
+// Rewrites the first parent of the record at `index` and recomputes the
+// checksum, so only the parent check can reject the file
+std::string with_first_parent(std::string graph, std::uint32_t count, std::uint32_t index, std::uint32_t parent) {
+    size_t record = 12 + 256 * 4 + static_cast<size_t>(count) * CommitGraph::ID_SIZE + static_cast<size_t>(index) * 20;
+    for (int i = 0; i < 4; ++i) {
+        graph[record + i] = static_cast<char>(parent >> (24 - 8 * i));
+    }
+    graph.resize(graph.size() - CommitGraph::ID_SIZE);
+    unsigned char digest[CommitGraph::ID_SIZE];
+    HashContext<Sha1Policy>::digest(graph.data(), graph.size(), digest);
+    graph.append(reinterpret_cast<const char*>(digest), CommitGraph::ID_SIZE);
+    return graph;
+}
+
+void test_corrupt_commit_graph(const std::string& root) {
+    std::filesystem::create_directories(root);
+    std::string path = root + "/commit-graph";
+    std::string graph = CommitGraph::build({{ID_A, {}, 1}, {ID_B, {ID_A}, 2}}, 0, nullptr);
+
+    CommitGraph opened;
+    utils::write_file(path, graph);
+    check(opened.open(path) && opened.size() == 2, "intact commit-graph opens");
+    check(opened.hash_at(2).empty() && opened.parents(2).empty(), "positions past the graph are refused");
+
+    std::string flipped = graph;
+    flipped[12 + 256 * 4] ^= 1;
+    utils::write_file(path, flipped);
+    check(!opened.open(path), "reject a commit-graph with a bad checksum");
+
+    // ID_A sorts first, so ID_B is record 1
+    utils::write_file(path, with_first_parent(graph, 2, 1, 2));
+    check(!opened.open(path), "reject a parent past the graph");
+    utils::write_file(path, with_first_parent(graph, 2, 1, 1));
+    check(!opened.open(path), "reject a commit that is its own parent");
+    utils::write_file(path, with_first_parent(graph, 2, 0, 1));
+    check(!opened.open(path), "reject a parent with a higher generation");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-objects-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+
+    test_commit_parsing();
+    test_blob_parsing();
+    test_fsck_reports_corrupt_commit(root);
+    test_corrupt_commit_graph(root + "/graph");
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Packs and the store around them: a PackWriter that is abandoned must
+// leave no temporary file behind, and a damaged multi-pack-index must fail
+// to open so that lookups fall back to the pack indexes. Geometric repack
+// must pick the packs that break the progression, and the incrementally
+// updated multi-pack-index must cover exactly the packs left afterwards.
+// A pack with a preset dictionary must read back, and its dictionary
+// entries must not be copied raw into another pack.
+#include "dictionary.h"
+#include "minigit.h"
+#include "multi_pack_index.h"
+#include "pack.h"
+#include "pack_store.h"
+#include "utils.h"
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::string id_of(const std::string& data) {
+    unsigned char digest[Sha1Policy::DIGEST_SIZE];
+    HashContext<Sha1Policy>::digest(data.data(), data.size(), digest);
+    return utils::hex_encode(digest, Sha1Policy::DIGEST_SIZE);
+}
+
+std::string blob(const std::string& content) {
+    return "blob " + std::to_string(content.size()) + "\n" + content;
+}
+
+// Names of temporary packs left in `dir`
+size_t temporaries(const std::string& dir) {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        count += entry.path().filename().string().starts_with("tmp-pack") ? 1 : 0;
+    }
+    return count;
+}
+
+void test_writer_cleanup(const std::string& dir) {
+    {
+        PackWriter writer(dir, 6);
+        check(writer.begin(), "begin a pack");
+        check(writer.add(id_of(blob("a")), blob("a")), "add an object");
+        check(!writer.add("not an id", blob("b")), "refuse a bad id");
+        check(temporaries(dir) == 1, "the pack is written to a temporary");
+    }
+    check(temporaries(dir) == 0, "an abandoned writer removes its temporary");
+
+    PackWriter writer(dir, 6);
+    check(writer.begin() && writer.add(id_of(blob("a")), blob("a")), "write a second pack");
+    std::string name = writer.finish();
+    check(!name.empty() && utils::file_exists(dir + "/" + name + ".pack"), "finish renames the pack into place");
+    check(temporaries(dir) == 0, "finish leaves no temporary");
+}
+
+std::string write_pack(const std::string& dir, const std::vector<std::string>& objects) {
+    PackWriter writer(dir, 6);
+    if (!writer.begin()) {
+        return "";
+    }
+    for (const auto& object : objects) {
+        writer.add(id_of(object), object);
+    }
+    return writer.finish();
+}
+
+void test_midx_checksum(const std::string& dir) {
+    check(!write_pack(dir, {blob("a"), blob("b")}).empty() && !write_pack(dir, {blob("c")}).empty(),
+          "write two packs");
+    PackStore store(dir, 1 << 16, 1 << 20, 1 << 20);
+    store.load();
+    check(store.write_multi_pack_index(), "write the multi-pack-index");
+
+    std::string path = dir + "/multi-pack-index";
+    MultiPackIndex midx;
+    check(midx.open(path) && midx.size() == 3, "intact midx opens");
+    midx.close();
+
+    // Flip a bit in the last location, past every structural check
+    std::string data = utils::read_file(path);
+    data[data.size() - Sha1Policy::DIGEST_SIZE - 1] ^= 1;
+    utils::write_file(path, data);
+    check(!midx.open(path), "reject a midx with a bad checksum");
+
+    PackStore reloaded(dir, 1 << 16, 1 << 20, 1 << 20);
+    reloaded.load();
+    check(reloaded.read(id_of(blob("a"))) == blob("a") && reloaded.read(id_of(blob("c"))) == blob("c"),
+          "objects read through the pack indexes instead");
+}
+
+// Object counts of the packs geometric_rollup(factor, loose) picks, for
+// packs of `sizes` objects
+std::multiset<size_t> rollup(const std::string& dir, const std::vector<size_t>& sizes, unsigned factor,
+                             size_t loose) {
+    size_t next = 0;
+    for (size_t size : sizes) {
+        std::vector<std::string> objects;
+        for (size_t i = 0; i < size; ++i, ++next) {
+            objects.push_back(blob(std::to_string(next)));
+        }
+        write_pack(dir, objects);
+    }
+    PackStore store(dir, 1 << 16, 1 << 20, 1 << 20);
+    store.load();
+    std::multiset<size_t> picked;
+    for (const auto* pack : store.geometric_rollup(factor, loose)) {
+        picked.insert(pack->get_index().size());
+    }
+    return picked;
+}
+
+void test_geometric_rollup(const std::string& dir) {
+    check(rollup(dir + "/1", {1, 2, 8, 32}, 2, 0).empty(), "a geometric progression is left alone");
+    check(rollup(dir + "/2", {1, 2, 8, 32}, 2, 1) == std::multiset<size_t>{1, 2},
+          "loose objects roll up the packs they outgrow");
+    check(rollup(dir + "/3", {3, 4, 20}, 2, 0) == std::multiset<size_t>{3, 4},
+          "the packs below a break in the progression are merged");
+    check(rollup(dir + "/4", {5, 6, 7}, 2, 0) == std::multiset<size_t>{5, 6, 7},
+          "the merged pack can pull in the packs above it");
+    check(rollup(dir + "/5", {3, 4, 20}, 3, 0) == std::multiset<size_t>{3, 4, 20},
+          "a larger factor merges more");
+}
+
+// Commands take paths relative to the working directory, as from the
+// command line
+void test_geometric_repack(const std::string& root) {
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::create_directories(root);
+    std::filesystem::current_path(root);
+    {
+        MiniGit git;
+        check(git.init(), "init a repository");
+        std::vector<std::string> files;
+        for (int i = 0; i < 10; ++i) {
+            files.push_back("big" + std::to_string(i) + ".txt");
+            utils::write_file(files.back(), files.back() + "\n");
+        }
+        check(git.add(files) && git.commit("ten files") && git.repack(), "pack eleven objects");
+    }
+    for (const std::string name : {"a.txt", "b.txt"}) {
+        MiniGit git;
+        utils::write_file(name, name + "\n");
+        check(git.add(name) && git.commit(name) && git.repack(), "pack two objects");
+    }
+
+    // 2, 2 and 11 objects: the two small packs break the progression
+    {
+        MiniGit git;
+        check(git.repack(2), "geometric repack");
+    }
+    std::string pack_dir = ".minigit/objects/pack";
+    std::set<std::string> on_disk;
+    for (const auto& entry : std::filesystem::directory_iterator(pack_dir)) {
+        if (entry.path().extension() == ".pack") {
+            on_disk.insert(entry.path().stem().string());
+        }
+    }
+    check(on_disk.size() == 2, "the two small packs are merged into one");
+
+    MultiPackIndex midx;
+    check(midx.open(pack_dir + "/multi-pack-index"), "the multi-pack-index opens");
+    const auto& names = midx.get_pack_names();
+    check(std::set<std::string>(names.begin(), names.end()) == on_disk, "it lists exactly the remaining packs");
+    check(midx.size() == 15, "it covers every object once");
+
+    MiniGit git;
+    std::ostringstream ids;
+    check(git.rev_list({"--all"}, true, ids), "list every object");
+    std::string request;
+    std::istringstream lines(ids.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+        request += line.substr(0, line.find(' ')) + "\n";
+    }
+    std::istringstream in(request);
+    std::ostringstream out;
+    check(git.cat_file_batch(false, in, out) && out.str().find("missing") == std::string::npos,
+          "every object reads through the new multi-pack-index");
+    std::filesystem::current_path(start);
+}
+
+// Small records sharing a vocabulary, as the dictionary is meant for
+std::vector<std::string> records(const std::string& kind, size_t count) {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(blob("{\"kind\": \"" + kind + "\", \"id\": " + std::to_string(i) +
+                              ", \"owner\": \"maintainers\", \"status\": \"reviewed and merged\"}\n"));
+    }
+    return result;
+}
+
+std::string read_pack_file(const std::string& dir, const std::string& name) {
+    return utils::read_file(dir + "/" + name + ".pack");
+}
+
+void test_dictionary_pack(const std::string& dir) {
+    std::vector<std::string> small = records("issue", 40);
+    std::string large = blob(std::string(4000, 'x') + "tail\n");
+
+    PackWriter writer(dir + "/source", 6);
+    writer.set_dictionary(dictionary::train(small, 4096), 1024);
+    check(writer.begin(), "begin a dictionary pack");
+    for (const auto& object : small) {
+        writer.add(id_of(object), object);
+    }
+    writer.add(id_of(large), large);
+    std::string name = writer.finish();
+    std::string bytes = read_pack_file(dir + "/source", name);
+    check(!name.empty() && bytes.size() > 8 && utils::get_be32(reinterpret_cast<const unsigned char*>(bytes.data()) + 4) == 2,
+          "a pack with a dictionary is version 2");
+
+    PackStore store(dir + "/source", 1 << 16, 1 << 20, 1 << 20);
+    store.load();
+    bool all_read = store.read(id_of(large)) == large;
+    for (const auto& object : small) {
+        all_read = all_read && store.read(id_of(object)) == object;
+    }
+    check(all_read, "every object in a version 2 pack reads back");
+
+    // Entries compressed with the source dictionary cannot be copied raw
+    // into a pack with another one; the rest are copied unchanged
+    PackWriter copy(dir + "/copy", 6);
+    copy.set_dictionary(dictionary::train(records("change", 40), 4096), 1024);
+    check(copy.begin(), "begin a pack with another dictionary");
+    size_t refused = 0;
+    std::vector<std::string> objects = small;
+    objects.push_back(large);
+    for (const auto& object : objects) {
+        PackLocation location;
+        std::string entry;
+        unsigned char id[Sha1Policy::DIGEST_SIZE];
+        utils::hex_decode(id_of(object), id);
+        if (store.find(id_of(object), location) && location.pack->copy_raw(location.offset, entry)) {
+            copy.add_raw(id, entry);
+        } else {
+            ++refused;
+            copy.add(id_of(object), object);
+        }
+    }
+    check(refused > 0 && refused <= small.size(), "dictionary entries are refused for raw copy");
+    PackLocation location;
+    std::string entry;
+    check(store.find(id_of(large), location) && location.pack->copy_raw(location.offset, entry),
+          "an entry without the dictionary is copied raw");
+    check(!copy.finish().empty(), "finish the copy");
+
+    PackStore copied(dir + "/copy", 1 << 16, 1 << 20, 1 << 20);
+    copied.load();
+    all_read = true;
+    for (const auto& object : objects) {
+        all_read = all_read && copied.read(id_of(object)) == object;
+    }
+    check(all_read, "every object reads back from the copy");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-pack-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    test_writer_cleanup(root + "/writer");
+    test_midx_checksum(root + "/midx");
+    test_geometric_rollup(root + "/rollup");
+    test_dictionary_pack(root + "/dictionary");
+    test_geometric_repack(root + "/repack");
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
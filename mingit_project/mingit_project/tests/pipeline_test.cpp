@@ -0,0 +1,151 @@
+// The coroutine pipeline behind commit: a Channel must hand every value
+// through in order while holding no more than its capacity, and blobs
+// written through the prepare, compress and write stages with a small
+// core.ioQueueDepth must all read back intact.
+#include "channel.h"
+#include "executor.h"
+#include "minigit.h"
+#include "task.h"
+#include "utils.h"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+void test_channel_backpressure() {
+    Executor executor(4);
+    const size_t CAPACITY = 2;
+    const int COUNT = 500;
+    Channel<int> channel(executor, CAPACITY);
+    std::atomic<int> pushed{0};
+    std::atomic<int> popped{0};
+    std::atomic<int> most_in_flight{0};
+    std::vector<int> received;
+
+    // Values pushed and not yet popped are in the buffer, so with one
+    // consumer their count never exceeds the capacity
+    auto produce = [&]() -> Task<> {
+        co_await executor.schedule();
+        for (int i = 0; i < COUNT; ++i) {
+            int value = i;
+            co_await channel.push(value);
+            ++pushed;
+        }
+        channel.close();
+    };
+    auto consume = [&]() -> Task<> {
+        co_await executor.schedule();
+        int value = 0;
+        while (co_await channel.pop(value)) {
+            ++popped;
+            received.push_back(value);
+            most_in_flight = std::max(most_in_flight.load(), pushed - popped);
+            if (value % 50 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    };
+
+    std::vector<Task<>> tasks;
+    tasks.push_back(produce());
+    tasks.push_back(consume());
+    sync_wait_all(std::move(tasks));
+
+    bool in_order = received.size() == COUNT;
+    for (int i = 0; in_order && i < COUNT; ++i) {
+        in_order = received[i] == i;
+    }
+    check(in_order, "every value arrives once, in order");
+    check(most_in_flight <= static_cast<int>(CAPACITY) + 1, "a slow consumer holds the producer back");
+}
+
+std::string blob_id(const std::string& content) {
+    std::string object = "blob " + std::to_string(content.size()) + std::string(1, '\0') + content;
+    unsigned char digest[Sha1Policy::DIGEST_SIZE];
+    HashContext<Sha1Policy>::digest(object.data(), object.size(), digest);
+    return utils::hex_encode(digest, Sha1Policy::DIGEST_SIZE);
+}
+
+// Commands take paths relative to the working directory, as from the
+// command line
+void test_write_objects(const std::string& root) {
+    const size_t FILES = 300;
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::create_directories(root);
+    std::filesystem::current_path(root);
+
+    std::vector<std::string> names;
+    std::vector<std::string> contents;
+    {
+        MiniGit git;
+        check(git.init(), "init a repository");
+        check(git.config_value("core.ioQueueDepth", "2") && git.config_value("core.compression", "6"),
+              "set a small queue depth and compression");
+    }
+    {
+        MiniGit git;
+        for (size_t i = 0; i < FILES; ++i) {
+            names.push_back("file" + std::to_string(i) + ".txt");
+            contents.push_back(std::string(i * 37 % 5000, static_cast<char>('a' + i % 26)) + std::to_string(i));
+            utils::write_file(names.back(), contents.back());
+        }
+        check(git.add(names) && git.commit("many blobs"), "commit many blobs through the pipeline");
+    }
+
+    MiniGit git;
+    std::string request;
+    for (const auto& content : contents) {
+        request += blob_id(content) + "\n";
+    }
+    std::istringstream in(request);
+    std::ostringstream out;
+    check(git.cat_file_batch(true, in, out), "read the blobs back");
+
+    std::string expected;
+    for (const auto& content : contents) {
+        expected += blob_id(content) + " blob " + std::to_string(content.size()) + "\n" + content + "\n";
+    }
+    check(out.str() == expected, "every blob reads back intact");
+    bool compressed = true;
+    for (const auto& content : contents) {
+        compressed = compressed && utils::is_compressed(utils::read_file(".minigit/objects/" + blob_id(content)));
+    }
+    check(compressed, "loose objects are stored compressed");
+    std::filesystem::current_path(start);
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-pipeline-test-" + std::to_string(std::time(nullptr))))
+                           .string();
+    std::filesystem::remove_all(root);
+
+    test_channel_backpressure();
+    test_write_objects(root);
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
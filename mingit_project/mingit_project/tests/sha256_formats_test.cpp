@@ -0,0 +1,192 @@
+// Round trip of the binary formats instantiated for SHA-256: writes packs,
+// a multi-pack-index and a two-layer commit-graph chain with 32-byte ids
+// into a scratch directory and reads everything back. Then a whole sha256
+// repository, from init through merge, repack and fsck.
+#include "commit_graph.h"
+#include "minigit.h"
+#include "object_id.h"
+#include "pack_store.h"
+#include "utils.h"
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+using Policy = Sha256Policy;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+std::string id_of(const std::string& data) {
+    unsigned char digest[Policy::DIGEST_SIZE];
+    HashContext<Policy>::digest(data.data(), data.size(), digest);
+    return utils::hex_encode(digest, Policy::DIGEST_SIZE);
+}
+
+std::string write_pack(const std::string& dir, const std::vector<std::string>& objects) {
+    BasicPackWriter<Policy> writer(dir, 6);
+    if (!writer.begin()) {
+        return "";
+    }
+    for (const auto& object : objects) {
+        writer.add(id_of(object), object);
+    }
+    return writer.finish();
+}
+
+void test_object_id() {
+    std::string hex = id_of("blob 3\nabc");
+    ObjectId<Policy> id;
+    check(ObjectId<Policy>::parse(hex, id), "parse a 64-digit id");
+    check(id.hex() == hex, "id hex round trip");
+    check(!ObjectId<Policy>::parse(hex.substr(0, 40), id), "reject a SHA-1 width id");
+    check(!ObjectId<Policy>::parse(std::string(63, '0') + "g", id), "reject a non-hex digit");
+
+    ObjectId<Policy> low;
+    ObjectId<Policy> high;
+    ObjectId<Policy>::parse(std::string(64, '0'), low);
+    ObjectId<Policy>::parse(std::string(63, '0') + "1", high);
+    check(low < high && low != high, "ids order bytewise");
+}
+
+void test_packs(const std::string& root) {
+    std::string dir = root + "/pack";
+    std::vector<std::string> first = {"blob 3\naaa", "blob 3\nbbb", "commit x\nmessage m\n"};
+    std::vector<std::string> second = {"blob 3\nccc", "blob 3\naaa"};
+    std::string name = write_pack(dir, first);
+    check(name.size() == 5 + 2 * Policy::DIGEST_SIZE, "pack named by a SHA-256 checksum");
+    check(!write_pack(dir, second).empty(), "write a second pack");
+
+    BasicPackStore<Policy> store(dir, 1 << 20, 1 << 24, 1 << 20);
+    store.load();
+    check(store.get_packs().size() == 2, "both packs load");
+    for (const auto& object : first) {
+        check(store.read(id_of(object)) == object, "read " + object.substr(0, 6) + " from its pack");
+    }
+    check(store.read(id_of("blob 3\nccc")) == "blob 3\nccc", "read from the second pack");
+    check(!store.has(id_of("blob 3\nddd")), "absent id is not found");
+    check(!store.has(id_of("blob 3\naaa").substr(0, 40)), "SHA-1 width id is not found");
+
+    check(store.write_multi_pack_index(), "write the multi-pack-index");
+    BasicMultiPackIndex<Policy> midx;
+    check(midx.open(dir + "/multi-pack-index") && midx.size() == 4, "midx lists each object once");
+    BasicPackStore<Policy> reopened(dir, 1 << 20, 1 << 24, 1 << 20);
+    reopened.load();
+    for (const auto& object : first) {
+        check(reopened.read(id_of(object)) == object, "read " + object.substr(0, 6) + " through the midx");
+    }
+    check(reopened.read(id_of("blob 3\nccc")) == "blob 3\nccc", "read the second pack through the midx");
+    check(!reopened.has(id_of("blob 3\nddd")), "absent id is not in the midx");
+}
+
+void test_commit_graph(const std::string& root) {
+    std::string info = root + "/info";
+    std::filesystem::create_directories(info);
+    std::string a = id_of("commit a");
+    std::string b = id_of("commit b");
+    std::string c = id_of("commit c");
+    std::string d = id_of("commit d");
+
+    {
+        BasicCommitGraphChain<Policy> chain(info);
+        chain.load();
+        check(chain.append({{a, {}, 1}, {b, {a}, 2}}, 2), "write the base layer");
+        // At ratio 1 a layer as large as the new one is kept, so this
+        // becomes a second layer
+        check(chain.append({{c, {b}, 3}, {d, {b, c}, 4}}, 1), "write a layer on top");
+
+        // A chain lock held by another writer is left alone
+        std::string lock = info + "/commit-graphs/commit-graph-chain.lock";
+        utils::write_file(lock, "");
+        check(!chain.append({{id_of("commit e"), {d}, 5}}, 2), "append gives up while the chain is locked");
+        check(std::filesystem::exists(lock), "a held chain lock is not removed");
+        std::filesystem::remove(lock);
+    }
+
+    BasicCommitGraphChain<Policy> chain(info);
+    chain.load();
+    check(chain.layer_count() == 2, "chain has two layers");
+    check(chain.size() == 4, "chain holds every commit");
+    std::uint32_t position = 0;
+    check(chain.find(d, position), "find a top-layer commit");
+    check(chain.generation(position) == 4, "generation spans layers");
+    check(chain.timestamp(position) == 4, "timestamp round trip");
+    std::vector<std::uint32_t> parents = chain.parents(position);
+    check(parents.size() == 2 && chain.hash_at(parents[0]) == b && chain.hash_at(parents[1]) == c,
+          "parents resolve across layers");
+    check(chain.find(a, position) && chain.generation(position) == 1, "root commit has generation 1");
+    check(!chain.find(id_of("commit e"), position), "absent commit is not found");
+}
+
+// Commands take paths relative to the working directory, as from the
+// command line
+void test_repository(const std::string& root) {
+    std::filesystem::path start = std::filesystem::current_path();
+    std::string dir = root + "/repo";
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+    {
+        BasicMiniGit<Policy> git;
+        check(git.init(), "init a sha256 repository");
+        utils::write_file("a.txt", "hello\n");
+        check(git.add("a.txt") && git.commit("first"), "first commit");
+        check(git.branch("side") && git.checkout("side"), "switch to a new branch");
+        utils::write_file("b.txt", "side\n");
+        check(git.add("b.txt") && git.commit("on side"), "commit on side");
+        check(git.checkout("main"), "switch back to main");
+        utils::write_file("a.txt", "hello again\n");
+        check(git.add("a.txt") && git.commit("second"), "commit on main");
+        check(git.merge("side") && git.repack(), "merge and repack");
+    }
+    std::filesystem::current_path(start);
+
+    ObjectFormat format = ObjectFormat::Sha1;
+    check(read_object_format(dir, format) && format == ObjectFormat::Sha256, "init records the object format");
+    BasicMiniGit<Policy> git(dir);
+    std::ostringstream out;
+    check(git.rev_list({"--all"}, true, out), "rev-list in a sha256 repository");
+    std::istringstream lines(out.str());
+    std::string line;
+    size_t count = 0;
+    bool all_ids = true;
+    while (std::getline(lines, line)) {
+        ObjectId<Policy> id;
+        all_ids = all_ids && ObjectId<Policy>::parse(line.substr(0, line.find(' ')), id);
+        ++count;
+    }
+    check(count == 7 && all_ids, "four commits and three blobs, all named by 64 hex digits");
+    check(out.str().find(id_of(std::string("blob 6\0hello\n", 13)) + " a.txt") != std::string::npos,
+          "blob ids are the SHA-256 of the object");
+    check(git.fsck(), "fsck passes on a sha256 repository");
+    check(!MiniGit(dir).is_repo_initialized(), "a sha256 repository does not open as sha1");
+}
+
+} // namespace
+
+int main() {
+    std::string root = (std::filesystem::temp_directory_path() /
+                        ("minigit-sha256-test-" + id_of(std::to_string(std::time(nullptr))).substr(0, 12)))
+                           .string();
+    std::filesystem::remove_all(root);
+
+    test_object_id();
+    test_packs(root);
+    test_commit_graph(root);
+    test_repository(root);
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}